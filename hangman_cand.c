@@ -0,0 +1,128 @@
+#include "hangman_cand.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int cand_alloc(struct cand_set *cs, const struct word_index *ix) {
+    cs->nblocks = ix->nblocks;
+    cs->bits = malloc(cs->nblocks * sizeof(uint64_t));
+    return cs->bits ? 0 : -1;
+}
+
+int cand_init_len(struct cand_set *cs, const struct word_index *ix,
+                  unsigned int len)
+{
+    if (len > MAX_WORD_LEN || cand_alloc(cs, ix) < 0) return -1;
+
+    memcpy(cs->bits, index_slot(ix, INDEX_LEN_SLOT((int)len)),
+           cs->nblocks * sizeof(uint64_t));
+    cs->count = ix->len_count[len];
+    memcpy(cs->letter_count, ix->len_letter_count[len], sizeof(cs->letter_count));
+    return 0;
+}
+
+int cand_init_board(struct cand_set *cs, const struct word_index *ix,
+                    const char *masked, size_t len, uint32_t excluded)
+{
+    if (cand_alloc(cs, ix) < 0) return -1;
+
+    cs->count = (uint32_t)index_match(ix, masked, len, excluded, cs->bits);
+    memset(cs->letter_count, 0, sizeof(cs->letter_count));
+    for (size_t b = 0; b < cs->nblocks; b++) {
+        for (uint64_t bits = cs->bits[b]; bits; bits &= bits - 1) {
+            size_t w = b * 64 + (size_t)__builtin_ctzll(bits);
+            for (uint32_t m = word_letters[w]; m; m &= m - 1) {
+                cs->letter_count[__builtin_ctz(m)]++;
+            }
+        }
+    }
+    return 0;
+}
+
+void cand_filter(struct cand_set *cs, int letter, uint16_t mask) {
+    for (size_t b = 0; b < cs->nblocks; b++) {
+        uint64_t bits = cs->bits[b];
+        uint64_t keep = bits;
+        while (bits) {
+            int bit = __builtin_ctzll(bits);
+            size_t w = b * 64 + (size_t)bit;
+            if (letter_pos[w][letter] != mask) {
+                keep &= ~(1ull << bit);
+                cs->count--;
+                for (uint32_t m = word_letters[w]; m; m &= m - 1) {
+                    cs->letter_count[__builtin_ctz(m)]--;
+                }
+            }
+            bits &= bits - 1;
+        }
+        cs->bits[b] = keep;
+    }
+}
+
+static _Thread_local uint32_t family_count[1 << MAX_WORD_LEN];
+static _Thread_local uint16_t family_touched[1 << MAX_WORD_LEN];
+
+uint16_t cand_largest_family(const struct cand_set *cs, int letter) {
+    int ntouched = 0;
+
+    for (size_t b = 0; b < cs->nblocks; b++) {
+        uint64_t bits = cs->bits[b];
+        while (bits) {
+            size_t w = b * 64 + (size_t)__builtin_ctzll(bits);
+            uint16_t m = letter_pos[w][letter];
+            if (family_count[m]++ == 0) {
+                family_touched[ntouched++] = m;
+            }
+            bits &= bits - 1;
+        }
+    }
+    if (ntouched == 0) return 0;
+
+    uint16_t best = family_touched[0];
+    for (int i = 1; i < ntouched; i++) {
+        uint16_t m = family_touched[i];
+        if (family_count[m] > family_count[best] ||
+            (family_count[m] == family_count[best] &&
+             __builtin_popcount(m) < __builtin_popcount(best))) {
+            best = m;
+        }
+    }
+    for (int i = 0; i < ntouched; i++) {
+        family_count[family_touched[i]] = 0;
+    }
+    return best;
+}
+
+int best_letter(const uint32_t letter_count[26], uint32_t guessed) {
+    int best = -1;
+    for (int c = 0; c < 26; c++) {
+        if ((guessed >> c) & 1) continue;
+        if (best < 0 || letter_count[c] > letter_count[best]) {
+            best = c;
+        }
+    }
+    if (best >= 0 && letter_count[best] == 0) {
+        return -1;
+    }
+    return best;
+}
+
+int cand_best_letter(const struct cand_set *cs, uint32_t guessed) {
+    return best_letter(cs->letter_count, guessed);
+}
+
+int cand_first(const struct cand_set *cs) {
+    for (size_t b = 0; b < cs->nblocks; b++) {
+        if (cs->bits[b]) {
+            return (int)(b * 64) + __builtin_ctzll(cs->bits[b]);
+        }
+    }
+    return -1;
+}
+
+void cand_free(struct cand_set *cs) {
+    free(cs->bits);
+    cs->bits = NULL;
+    cs->nblocks = 0;
+    cs->count = 0;
+}
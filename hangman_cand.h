@@ -0,0 +1,51 @@
+#ifndef HANGMAN_CAND_H
+#define HANGMAN_CAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_index.h"
+
+// Per-game candidate set: the words still consistent with the board.
+// Narrowed in place after every guess; letter_count is kept in step so
+// hint queries never rescan the dictionary.
+struct cand_set {
+    uint64_t *bits;
+    size_t    nblocks;
+    uint32_t  count;
+    uint32_t  letter_count[26];   // candidates containing 'a' + c
+};
+
+// Start from every word of length len. 0 on success, -1 on failure.
+int cand_init_len(struct cand_set *cs, const struct word_index *ix,
+                  unsigned int len);
+
+// Start from an existing board (see index_match for the arguments).
+int cand_init_board(struct cand_set *cs, const struct word_index *ix,
+                    const char *masked, size_t len, uint32_t excluded);
+
+// Keep only words whose positions of letter (0..25) are exactly mask.
+// A miss is mask 0.
+void cand_filter(struct cand_set *cs, int letter, uint16_t mask);
+
+// Adversarial ("evil") step: the reveal mask of letter shared by the most
+// candidates. Ties go to the mask revealing fewest positions, so a miss
+// beats any hit. Uses per-thread static scratch.
+uint16_t cand_largest_family(const struct cand_set *cs, int letter);
+
+// Unguessed letter contained in the most words, given per-letter word
+// counts. Ties go to the earlier letter. Returns 0..25, or -1 if every
+// unguessed letter has a zero count.
+int best_letter(const uint32_t letter_count[26], uint32_t guessed);
+
+// Unguessed letter most likely to hit, i.e. the one minimising expected
+// misses. guessed has bit c set for letters already tried. Returns 0..25,
+// or -1 if no candidate remains or every letter has been tried.
+int cand_best_letter(const struct cand_set *cs, uint32_t guessed);
+
+// Index of the lowest-numbered candidate, or -1 if empty.
+int cand_first(const struct cand_set *cs);
+
+void cand_free(struct cand_set *cs);
+
+#endif
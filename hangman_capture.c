@@ -0,0 +1,194 @@
+#include "hangman_capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_proto.h"
+
+static const char    *cap_dir;          // NULL = capture off
+static struct cap_buf mine;             // a game child's trace
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int cap_setup(const char *dir) {
+    if (access(dir, W_OK | X_OK) < 0) return -1;
+    cap_dir = dir;
+    return 0;
+}
+
+void cap_buf_begin(struct cap_buf *b) {
+    if (!cap_dir) return;
+    memset(&b->hdr, 0, sizeof(b->hdr));
+    b->hdr.magic   = CAP_MAGIC;
+    b->hdr.version = CAP_VERSION;
+    b->len     = 0;
+    b->last_us = now_us();
+    b->active  = 1;
+}
+
+static int reserve(struct cap_buf *b, size_t more) {
+    if (b->len + more <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + more) cap *= 2;
+    unsigned char *p = realloc(b->buf, cap);
+    if (!p) return -1;
+    b->buf = p;
+    b->cap = cap;
+    return 0;
+}
+
+void cap_buf_frame(struct cap_buf *b, enum cap_dir dir, const void *data, size_t len) {
+    if (!b->active) return;
+    if (reserve(b, 1 + 2 * VARINT_MAX + len) < 0) {
+        // Out of memory: give up on this trace rather than write half of it.
+        b->active = 0;
+        return;
+    }
+    uint64_t now = now_us();
+    uint64_t delta = now - b->last_us;
+    b->buf[b->len++] = (unsigned char)dir;
+    b->len += varint_put(b->buf + b->len, delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta);
+    b->len += varint_put(b->buf + b->len, (uint32_t)len);
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->last_us = now;
+    b->hdr.records++;
+}
+
+void cap_buf_word(struct cap_buf *b, const struct session_pack *p, uint32_t num_words) {
+    if (!b->active) return;
+    b->hdr.word_idx      = (uint32_t)p->word_idx;
+    b->hdr.num_words     = num_words;
+    b->hdr.evil          = p->evil;
+    b->hdr.guessed       = p->guessed;
+    b->hdr.num_incorrect = p->num_incorrect;
+    memcpy(b->hdr.incorrect, p->incorrect, sizeof(b->hdr.incorrect));
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int cap_buf_finish(struct cap_buf *b, const char *name) {
+    int was_active = b->active;
+    b->active = 0;
+    if (!was_active || b->hdr.num_words == 0) return 0;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/hangman_capture.%s.bin", cap_dir, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    int rc = write_all(fd, &b->hdr, sizeof(b->hdr)) < 0 ||
+             write_all(fd, b->buf, b->len) < 0 ? -1 : 0;
+    close(fd);
+    return rc;
+}
+
+void cap_buf_free(struct cap_buf *b) {
+    free(b->buf);
+    memset(b, 0, sizeof(*b));
+}
+
+void cap_begin(void) {
+    cap_buf_begin(&mine);
+}
+
+void cap_frame(enum cap_dir dir, const void *data, size_t len) {
+    cap_buf_frame(&mine, dir, data, len);
+}
+
+void cap_word(const struct session_pack *p, uint32_t num_words) {
+    cap_buf_word(&mine, p, num_words);
+}
+
+int cap_finish(uint32_t session) {
+    char name[16];
+    snprintf(name, sizeof(name), "%u", session);
+    return cap_buf_finish(&mine, name);
+}
+
+// ---------- reader ----------
+
+int cap_load(const char *path, struct cap_trace *t) {
+    memset(t, 0, sizeof(*t));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&t->hdr, sizeof(t->hdr), 1, f) != 1 || t->hdr.magic != CAP_MAGIC ||
+        t->hdr.version != CAP_VERSION) {
+        fprintf(stderr, "%s: not a capture trace (or wrong version)\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    size_t cap = 4096, len = 0;
+    t->raw = malloc(cap);
+    for (;;) {
+        if (!t->raw) break;
+        len += fread(t->raw + len, 1, cap - len, f);
+        if (len < cap) break;
+        cap *= 2;
+        unsigned char *p = realloc(t->raw, cap);
+        if (!p) {
+            free(t->raw);
+            t->raw = NULL;
+        } else {
+            t->raw = p;
+        }
+    }
+    fclose(f);
+    t->rec = calloc(t->hdr.records ? t->hdr.records : 1, sizeof(*t->rec));
+    if (!t->raw || !t->rec) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        cap_free(t);
+        return -1;
+    }
+
+    const unsigned char *p = t->raw, *end = t->raw + len;
+    while (p < end && t->n < t->hdr.records) {
+        struct cap_record *r = &t->rec[t->n];
+        r->dir = *p++;
+        if ((r->dir != CAP_IN && r->dir != CAP_OUT) ||
+            varint_get(&p, end, &r->delta_us) < 0 ||
+            varint_get(&p, end, &r->len) < 0 || (size_t)(end - p) < r->len) {
+            break;
+        }
+        r->data = p;
+        p += r->len;
+        t->n++;
+    }
+    if (t->n != t->hdr.records || p != end) {
+        fprintf(stderr, "%s: truncated or corrupt at record %zu\n", path, t->n);
+        cap_free(t);
+        return -1;
+    }
+    return 0;
+}
+
+void cap_free(struct cap_trace *t) {
+    free(t->rec);
+    free(t->raw);
+    memset(t, 0, sizeof(*t));
+}
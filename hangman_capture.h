@@ -0,0 +1,110 @@
+#ifndef HANGMAN_CAPTURE_H
+#define HANGMAN_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_game.h"
+
+// Capture mode: every frame of a solo game, both directions, with
+// timestamps, in one compact binary file per game.
+//
+// A game child appends each frame to an in-memory buffer as it goes and
+// writes the whole trace with one write(2) when the session ends, so
+// the game loop never waits on the disk. A worker thread (--workers)
+// keeps a buffer per session the same way; its traces are named
+// <server pid>-<session id>, since session ids restart with the server.
+// A game moved to a new server by a hot upgrade is not written. Only solo
+// games are written; room, race and query connections are dropped. A
+// game resumed with its token (--resume) is written with the state it
+// picked up from, and the token itself is never captured, so replay
+// compares only what does not change from run to run. hangman_replay drives a server with the client side of a
+// trace and checks the server side matches.
+//
+// File layout: struct cap_header, then records back to back:
+//   [dir: CAP_IN | CAP_OUT][varint µs since previous record][varint len][len bytes]
+// Varints are LEB128 (7 bits per byte, low bits first). Inbound records
+// are whole client frames ([len][payload]) as they arrived on the wire;
+// outbound records are one send_frame() each.
+
+#define CAP_MAGIC    0x50434d48u    // "HMCP"
+#define CAP_VERSION  2
+
+enum cap_dir {
+    CAP_IN  = 'I',      // client -> server
+    CAP_OUT = 'O',      // server -> client
+};
+
+struct cap_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t word_idx;      // secret word the session started with
+    uint32_t num_words;     // dictionary size; replay sends it and evil with W
+    uint32_t evil;          // server ran with --evil
+    uint32_t records;
+    // A resumed game: letters already guessed (bit per letter, 0 for a
+    // new game) and the misses among them, in order.
+    uint32_t      guessed;
+    uint32_t      num_incorrect;
+    unsigned char incorrect[MAX_INCORRECT];
+};
+
+// ---------- server side ----------
+
+// Enable capture into dir (must exist and be writable). 0 or -1.
+int cap_setup(const char *dir);
+
+// Start a new trace in this process (a game child). No-op unless enabled.
+void cap_begin(void);
+
+// Append one frame. No-op outside cap_begin .. cap_finish.
+void cap_frame(enum cap_dir dir, const void *data, size_t len);
+
+// Mark the trace as a replayable solo game starting from p: a new game's
+// packed state right after session_start, or the state a resumed one
+// was unpacked from.
+void cap_word(const struct session_pack *p, uint32_t num_words);
+
+// Write <dir>/hangman_capture.<session>.bin if cap_word was called, and
+// drop the buffer. 0 on success or nothing to write, -1 on error.
+int cap_finish(uint32_t session);
+
+// The same for a trace the caller keeps, one per session (a worker
+// thread). Zeroed is idle; cap_buf_free releases the memory.
+struct cap_buf {
+    int               active;
+    unsigned char    *buf;
+    size_t            len, cap;
+    uint64_t          last_us;
+    struct cap_header hdr;
+};
+
+void cap_buf_begin(struct cap_buf *b);
+void cap_buf_frame(struct cap_buf *b, enum cap_dir dir, const void *data, size_t len);
+void cap_buf_word(struct cap_buf *b, const struct session_pack *p, uint32_t num_words);
+
+// Write <dir>/hangman_capture.<name>.bin, as cap_finish does.
+int cap_buf_finish(struct cap_buf *b, const char *name);
+void cap_buf_free(struct cap_buf *b);
+
+// ---------- reader side ----------
+
+struct cap_record {
+    uint8_t              dir;
+    uint32_t             delta_us;
+    uint32_t             len;
+    const unsigned char *data;      // points into cap_trace.raw
+};
+
+struct cap_trace {
+    struct cap_header  hdr;
+    struct cap_record *rec;
+    size_t             n;
+    unsigned char     *raw;
+};
+
+// Load and parse a trace. 0 on success, -1 on error (message on stderr).
+int cap_load(const char *path, struct cap_trace *t);
+void cap_free(struct cap_trace *t);
+
+#endif
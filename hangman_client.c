@@ -1,11 +1,23 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/random.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hangman_dict.h"
+#include "hangman_index.h"
+#include "hangman_cand.h"
+#include "hangman_proto.h"
+#include "hangman_room.h"
+#include "hangman_match.h"
+#include "hangman_udp.h"
 
 // ---------- utilities ----------
 
@@ -36,18 +48,206 @@ static int send_all(int fd, const char *buf, size_t len) {
     return 0;
 }
 
+// One decoded server packet.
+struct server_packet {
+    int           kind;                 // PKT_* below
+    int           status;               // v2 status code (V2_ST_*), 0 if none
+    unsigned char msg_len;              // message packets
+    unsigned char word_len;             // game-control packets
+    unsigned char num_incorrect;
+    unsigned char data[256];            // message text, or masked + incorrect
+};
+
+enum {
+    PKT_OVERLOADED = 1,   // "server-overloaded" message
+    PKT_GAME_OVER  = 2,   // "Game Over!" message
+    PKT_BOARD      = 3,   // game-control packet (board update)
+    PKT_MESSAGE    = 4,   // other message ("Welcome...", "You Win!", ...)
+};
+
+// v1 has no codes: these texts stand in for them. v2 only needs the
+// table for the welcome-time server-overloaded, which precedes the start
+// frame and so is always v1.
+static const struct {
+    const char   *text;
+    unsigned char len;
+    int           kind;
+} legacy_codes[] = {
+    { "server-overloaded", 17, PKT_OVERLOADED },
+    { "Game Over!",        10, PKT_GAME_OVER  },
+};
+
+// Framing of the server packets still to come on this connection: set
+// once a v2 start frame has been sent, cleared on connect.
+static int proto_v2 = 0;
+
+// Client-side text for v2 status codes.
+static const char *const status_text[] = {
+    [V2_ST_WIN]       = "You Win!",
+    [V2_ST_LOSE]      = "You Lose.",
+    [V2_ST_GAME_OVER] = "Game Over!",
+};
+
+static int recv_varint(int sockfd, uint32_t *out) {
+    unsigned char buf[VARINT_MAX];
+    for (size_t n = 0; n < sizeof(buf); n++) {
+        if (recv_all(sockfd, &buf[n], 1) < 0) return -1;
+        if (!(buf[n] & 0x80)) {
+            const unsigned char *p = buf;
+            return varint_get(&p, buf + n + 1, out);
+        }
+    }
+    return -1;
+}
+
+// Read and drop len bytes.
+static int skip_bytes(int sockfd, uint32_t len) {
+    unsigned char tmp[256];
+    while (len > 0) {
+        uint32_t chunk = len < sizeof(tmp) ? len : (uint32_t)sizeof(tmp);
+        if (recv_all(sockfd, tmp, chunk) < 0) return -1;
+        len -= chunk;
+    }
+    return 0;
+}
+
+// The board as of the last v2 frame: V2_BOARD replaces it, V2_REVEAL and
+// V2_MISS update it, and either way the caller gets the whole board.
+struct v2_board {
+    unsigned char word_len, num_incorrect;
+    unsigned char masked[MAX_WORD_LEN];
+    unsigned char incorrect[MAX_WORD_LEN];
+};
+
+static struct v2_board board;   // the TCP connection's
+
+static int board_packet(const struct v2_board *b, struct server_packet *pkt) {
+    pkt->kind          = PKT_BOARD;
+    pkt->word_len      = b->word_len;
+    pkt->num_incorrect = b->num_incorrect;
+    memcpy(pkt->data, b->masked, b->word_len);
+    memcpy(pkt->data + b->word_len, b->incorrect, b->num_incorrect);
+    return PKT_BOARD;
+}
+
+// Decode the payload d[0..len) of one v2 frame into pkt, updating b.
+// Returns the packet kind, 0 for a frame this client skips, -1 if the
+// frame is malformed.
+static int decode_v2(unsigned char type, const unsigned char *d, uint32_t len,
+                     struct v2_board *b, struct server_packet *pkt)
+{
+    pkt->status = 0;
+
+    if (type == V2_TEXT) {
+        // Longer than we display: keep the start.
+        pkt->kind    = PKT_MESSAGE;
+        pkt->msg_len = (unsigned char)(len < 255 ? len : 255);
+        memcpy(pkt->data, d, pkt->msg_len);
+        return PKT_MESSAGE;
+    }
+
+    if (type == V2_BOARD) {
+        if (len < 2 || d[0] == 0 || d[0] > MAX_WORD_LEN || d[0] > len - 1 ||
+            len - 1 - d[0] > MAX_WORD_LEN) {
+            return -1;
+        }
+        b->word_len      = d[0];
+        b->num_incorrect = (unsigned char)(len - 1 - b->word_len);
+        memcpy(b->masked, d + 1, b->word_len);
+        memcpy(b->incorrect, d + 1 + b->word_len, b->num_incorrect);
+        return board_packet(b, pkt);
+    }
+
+    if ((type == V2_REVEAL && len == 3) || (type == V2_MISS && len == 1)) {
+        if (b->word_len == 0) return -1;
+        if (type == V2_REVEAL) {
+            uint16_t mask = (uint16_t)(d[1] | d[2] << 8);
+            for (unsigned char i = 0; i < b->word_len; i++) {
+                if ((mask >> i) & 1) b->masked[i] = d[0];
+            }
+        } else if (b->num_incorrect < MAX_WORD_LEN) {
+            b->incorrect[b->num_incorrect++] = d[0];
+        }
+        return board_packet(b, pkt);
+    }
+
+    if (type == V2_STATUS) {
+        const unsigned char *p = d;
+        uint32_t code;
+        if (varint_get(&p, d + len, &code) < 0) return -1;
+        if (code >= sizeof(status_text) / sizeof(status_text[0]) || !status_text[code]) {
+            return 0;   // a code this client does not know
+        }
+        pkt->status  = (int)code;
+        pkt->kind    = code == V2_ST_GAME_OVER ? PKT_GAME_OVER : PKT_MESSAGE;
+        pkt->msg_len = (unsigned char)strlen(status_text[code]);
+        memcpy(pkt->data, status_text[code], pkt->msg_len);
+        return pkt->kind;
+    }
+
+    if (type == V2_WORD || type == V2_HINT) {
+        // Raw letters; the text is ours to format.
+        if (len > MAX_WORD_LEN || (type == V2_HINT && len > 1)) return -1;
+        int n;
+        if (type == V2_HINT) {
+            n = len ? snprintf((char *)pkt->data, sizeof(pkt->data), "Hint: %c", d[0])
+                    : snprintf((char *)pkt->data, sizeof(pkt->data), "Hint: none");
+        } else {
+            n = snprintf((char *)pkt->data, sizeof(pkt->data), "The word was");
+            for (uint32_t i = 0; i < len; i++) {
+                n += snprintf((char *)pkt->data + n, sizeof(pkt->data) - (size_t)n, " %c", d[i]);
+            }
+        }
+        pkt->kind    = PKT_MESSAGE;
+        pkt->msg_len = (unsigned char)n;
+        return PKT_MESSAGE;
+    }
+
+    return 0;   // a frame type from a newer server
+}
+
+// v2 counterpart of recv_one_packet: [type][varint len][payload].
+static int recv_v2_packet(int sockfd, struct server_packet *pkt) {
+    for (;;) {
+        unsigned char type;
+        uint32_t len;
+        if (recv_all(sockfd, &type, 1) < 0 || recv_varint(sockfd, &len) < 0) {
+            fprintf(stderr, "Error: failed to read frame header from server\n");
+            return -1;
+        }
+
+        // Only text can run past what we keep; the rest of it is dropped.
+        unsigned char payload[512];
+        uint32_t keep = len < sizeof(payload) ? len : (uint32_t)sizeof(payload);
+        if (recv_all(sockfd, payload, keep) < 0 || skip_bytes(sockfd, len - keep) < 0) {
+            fprintf(stderr, "Error: failed to read frame from server\n");
+            return -1;
+        }
+        int r = keep < len && type != V2_TEXT ? -1 : decode_v2(type, payload, keep, &board, pkt);
+        if (r < 0) {
+            fprintf(stderr, "Error: bad frame (type %u) from server\n", type);
+            return -1;
+        }
+        if (r > 0) return r;
+    }
+}
+
 /*
- * Receive exactly one server packet (message or game-control), print it,
- * and return:
+ * Receive exactly one server packet (message or game-control) and return:
  *   1 = "server-overloaded" message
  *   2 = "Game Over!" message
  *   3 = game-control packet (board update)
  *   4 = other message ("Welcome...", "The word was...", "You Win!", "You Lose.")
  *  -1 = error
  */
-static int recv_and_print_one_packet(int sockfd) {
+static int recv_one_packet(int sockfd, struct server_packet *pkt) {
     unsigned char msg_flag;
 
+    if (proto_v2) {
+        return recv_v2_packet(sockfd, pkt);
+    }
+    pkt->status = 0;
+
     // Read first byte: msg_flag
     if (recv_all(sockfd, &msg_flag, 1) < 0) {
         fprintf(stderr, "Error: failed to read msg_flag from server\n");
@@ -56,119 +256,706 @@ static int recv_and_print_one_packet(int sockfd) {
 
     if (msg_flag > 0) {
         // Message packet
-        unsigned char data[256];
-
-        if (recv_all(sockfd, data, msg_flag) < 0) {
+        if (recv_all(sockfd, pkt->data, msg_flag) < 0) {
             fprintf(stderr, "Error: failed to read message data\n");
             return -1;
         }
+        pkt->msg_len = msg_flag;
 
-        const char *over = "server-overloaded";
-        size_t over_len  = strlen(over);
+        // Normal message (welcome, "The word was ...", "You Win!", "You
+        // Lose.") unless it is one of the texts v1 uses as a code.
+        pkt->kind = PKT_MESSAGE;
+        for (size_t i = 0; i < sizeof(legacy_codes) / sizeof(legacy_codes[0]); i++) {
+            if (msg_flag == legacy_codes[i].len &&
+                memcmp(pkt->data, legacy_codes[i].text, msg_flag) == 0) {
+                pkt->kind = legacy_codes[i].kind;
+                break;
+            }
+        }
+        return pkt->kind;
+    }
 
-        const char *game_over = "Game Over!";
-        size_t game_over_len  = strlen(game_over);
+    // Game-control packet
+    unsigned char header[2];  // word_length, num_incorrect
+    if (recv_all(sockfd, header, 2) < 0) {
+        fprintf(stderr, "Error: failed to read game-control header\n");
+        return -1;
+    }
 
-        if (msg_flag == over_len && memcmp(data, over, over_len) == 0) {
-            printf(">>>%.*s\n", (int)msg_flag, (char *)data);
-            return 1;  // overloaded
-        }
+    unsigned char word_len      = header[0];
+    unsigned char num_incorrect = header[1];
+
+    if (word_len > MAX_WORD_LEN) {
+        fprintf(stderr, "Error: invalid word length from server\n");
+        return -1;
+    }
+
+    unsigned int data_len = (unsigned int)word_len + (unsigned int)num_incorrect;
+    if (data_len > MAX_WORD_LEN + MAX_WORD_LEN) {
+        fprintf(stderr, "Error: game-control data too long\n");
+        return -1;
+    }
+
+    if (recv_all(sockfd, pkt->data, data_len) < 0) {
+        fprintf(stderr, "Error: failed to read game-control data\n");
+        return -1;
+    }
 
-        if (msg_flag == game_over_len && memcmp(data, game_over, game_over_len) == 0) {
-            printf(">>>%.*s\n", (int)msg_flag, (char *)data);
-            return 2;  // explicit end of game
+    pkt->kind          = PKT_BOARD;
+    pkt->word_len      = word_len;
+    pkt->num_incorrect = num_incorrect;
+    return PKT_BOARD;
+}
+
+static void print_packet(const struct server_packet *pkt) {
+    if (pkt->kind != PKT_BOARD) {
+        printf(">>>%.*s\n", (int)pkt->msg_len, (const char *)pkt->data);
+        return;
+    }
+
+    const unsigned char *word_state = pkt->data;
+    const unsigned char *incorrect  = pkt->data + pkt->word_len;
+
+    // Print masked word like: >>>_ _ _
+    printf(">>>");
+    for (unsigned char i = 0; i < pkt->word_len; i++) {
+        printf("%c", word_state[i]);
+        if (i + 1 < pkt->word_len) {
+            printf(" ");
         }
+    }
+    printf("\n");
 
-        // Normal message (welcome, "The word was ...", "You Win!", "You Lose.")
-        printf(">>>%.*s\n", (int)msg_flag, (char *)data);
-        return 4;
-    } else {
-        // Game-control packet
-        unsigned char header[2];  // word_length, num_incorrect
-        if (recv_all(sockfd, header, 2) < 0) {
-            fprintf(stderr, "Error: failed to read game-control header\n");
-            return -1;
+    // Print incorrect guesses line
+    printf(">>>Incorrect Guesses:");
+    if (pkt->num_incorrect > 0) {
+        printf(" ");
+        for (unsigned char j = 0; j < pkt->num_incorrect; j++) {
+            printf("%c", incorrect[j]);
+            if (j + 1 < pkt->num_incorrect) {
+                printf(" ");
+            }
         }
+    }
+    printf("\n");
 
-        unsigned char word_len      = header[0];
-        unsigned char num_incorrect = header[1];
+    // Blank line with >>>
+    printf(">>>\n");
+}
 
-        if (word_len > 8) {
-            fprintf(stderr, "Error: invalid word length from server\n");
-            return -1;
+// Receive one packet, print it, and return its kind (see recv_one_packet).
+static int recv_and_print_one_packet(int sockfd) {
+    struct server_packet pkt;
+    int r = recv_one_packet(sockfd, &pkt);
+    if (r > 0) {
+        print_packet(&pkt);
+    }
+    return r;
+}
+
+static int connect_to_server(const char *server_ip, int server_port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family      = AF_INET;
+    server_addr.sin_port        = htons(server_port);
+    server_addr.sin_addr.s_addr = inet_addr(server_ip);
+
+    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("connect");
+        close(sockfd);
+        return -1;
+    }
+    proto_v2 = 0;   // the welcome is always v1
+    board.word_len = 0;
+    return sockfd;
+}
+
+// Send the start frame: empty, or [len][cmd] for a start command. With
+// v2 set, ask for v2 framing with delta boards (solo games only); the
+// packets after this are read as v2.
+static int send_start(int sockfd, const char *cmd, int v2) {
+    unsigned char frame[1 + 2 + 64];
+    size_t len = cmd ? strlen(cmd) : 0;
+    size_t pre = v2 ? 2 : 0;
+    if (pre + len >= sizeof(frame)) return -1;
+    frame[0] = (unsigned char)(pre + len);
+    frame[1] = START_V2;
+    frame[2] = V2_F_DELTA;  // features
+    memcpy(frame + 1 + pre, cmd, len);
+    if (send_all(sockfd, (char *)frame, 1 + pre + len) < 0) return -1;
+    proto_v2 = v2;
+    return 0;
+}
+
+// ---------- bot mode ----------
+//
+// Plays games back to back without prompting. Each board narrows a local
+// candidate set (same dictionary and solver as the server's hint frame),
+// so the bot needs no hint round trips.
+
+struct bot_stats {
+    long games, wins, losses, rejected, misses;
+};
+
+// Next letter (0..25) for the candidates left, marked in *guessed; -1 if
+// every letter has been tried.
+static int bot_pick(const struct cand_set *cand, uint32_t *guessed) {
+    static const char fallback[] = "etaoinshrdlcumwfgypbvkjxqz";
+    int c = cand_best_letter(cand, *guessed);
+    for (const char *f = fallback; c < 0 && *f; f++) {
+        if (!((*guessed >> (*f - 'a')) & 1)) c = *f - 'a';
+    }
+    if (c >= 0) *guessed |= 1u << c;
+    return c;
+}
+
+// Play one game on a fresh connection. 0 = finished, 1 = server
+// overloaded, -1 = error.
+static int bot_play_one(const char *server_ip, int server_port,
+                        const struct word_index *ix, struct bot_stats *st)
+{
+    struct server_packet pkt;
+    int sockfd = connect_to_server(server_ip, server_port);
+    if (sockfd < 0) return -1;
+
+    int r = recv_one_packet(sockfd, &pkt);
+    if (r != PKT_MESSAGE) {
+        close(sockfd);
+        return r == PKT_OVERLOADED ? 1 : -1;
+    }
+
+    if (send_start(sockfd, NULL, 1) < 0) {
+        close(sockfd);
+        return -1;
+    }
+    while ((r = recv_one_packet(sockfd, &pkt)) == PKT_MESSAGE) {
+    }
+    if (r != PKT_BOARD) {
+        close(sockfd);
+        return r == PKT_GAME_OVER ? 0 : -1;
+    }
+
+    struct cand_set cand;
+    if (cand_init_len(&cand, ix, pkt.word_len) < 0) {
+        close(sockfd);
+        return -1;
+    }
+
+    uint32_t guessed = 0;
+    int result = -1;
+
+    for (;;) {
+        // Narrow to words matching the latest board, then pick a letter.
+        int c = bot_pick(&cand, &guessed);
+        if (c < 0) break;
+
+        unsigned char guess[2] = { 1, (unsigned char)('a' + c) };
+        if (send_all(sockfd, (char *)guess, sizeof(guess)) < 0) break;
+
+        int won = 0;
+        while ((r = recv_one_packet(sockfd, &pkt)) == PKT_MESSAGE) {
+            if (pkt.status == V2_ST_WIN) won = 1;
+        }
+        if (r == PKT_GAME_OVER) {
+            st->games++;
+            if (won) st->wins++; else st->losses++;
+            result = 0;
+            break;
         }
+        if (r != PKT_BOARD) break;
 
-        unsigned int data_len = (unsigned int)word_len + (unsigned int)num_incorrect;
-        unsigned char data[16];  // enough for 8 + 8
-        if (data_len > sizeof(data)) {
-            fprintf(stderr, "Error: game-control data too long\n");
-            return -1;
+        uint16_t mask = 0;
+        for (unsigned char i = 0; i < pkt.word_len; i++) {
+            if (pkt.data[i] == 'a' + c) mask |= (uint16_t)(1u << i);
         }
+        if (mask == 0) st->misses++;
+        cand_filter(&cand, c, mask);
+    }
 
-        if (recv_all(sockfd, data, data_len) < 0) {
-            fprintf(stderr, "Error: failed to read game-control data\n");
-            return -1;
+    cand_free(&cand);
+    close(sockfd);
+    return result;
+}
+
+static int run_bot(const char *server_ip, int server_port, long games,
+                   const char *words_file)
+{
+    load_words(words_file);
+
+    struct word_index ix;
+    if (index_build(&ix) < 0) {
+        perror("index_build");
+        return 1;
+    }
+
+    struct bot_stats st = {0};
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    while (games == 0 || st.games < games) {
+        int r = bot_play_one(server_ip, server_port, &ix, &st);
+        if (r < 0) {
+            index_free(&ix);
+            return 1;
+        }
+        if (r == 1) {
+            // Server is at MAX_CLIENTS; back off briefly and retry.
+            st.rejected++;
+            usleep(1000);
         }
+    }
 
-        unsigned char *word_state = data;
-        unsigned char *incorrect  = data + word_len;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (double)(t1.tv_sec - t0.tv_sec) +
+                     (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
 
-        // Print masked word like: >>>_ _ _
-        printf(">>>");
-        for (unsigned char i = 0; i < word_len; i++) {
-            printf("%c", word_state[i]);
-            if (i + 1 < word_len) {
-                printf(" ");
+    printf("games %ld, wins %ld, losses %ld, rejected %ld\n",
+           st.games, st.wins, st.losses, st.rejected);
+    printf("avg misses %.2f, %.1f games/s\n",
+           st.games ? (double)st.misses / (double)st.games : 0.0,
+           elapsed > 0 ? (double)st.games / elapsed : 0.0);
+
+    index_free(&ix);
+    return 0;
+}
+
+// ---------- UDP mode ----------
+//
+// Solo games over datagrams (see hangman_udp.h): every request waits for
+// its reply, and is sent again if none arrives in time. The bot keeps
+// many games in flight on one socket; the token's low 16 bits say which.
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t token_state;
+
+// A fresh game token: random high bits, slot in the low 16.
+static uint64_t udp_token(unsigned slot) {
+    if (!token_state && getrandom(&token_state, sizeof(token_state), 0) != sizeof(token_state)) {
+        token_state = mono_ns() ^ ((uint64_t)getpid() << 32);
+    }
+    // xorshift64*
+    token_state ^= token_state >> 12;
+    token_state ^= token_state << 25;
+    token_state ^= token_state >> 27;
+    uint64_t r = token_state * 0x2545f4914f6cdd1dull;
+    return (r << 16) | (slot & 0xffff) | (r ? 0 : 1u << 16);
+}
+
+static int udp_socket(const char *server_ip, int server_port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(server_port);
+    addr.sin_addr.s_addr = inet_addr(server_ip);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One game's request in flight.
+struct udp_game {
+    uint64_t        token;
+    uint32_t        seq;
+    unsigned char   req[UDP_HDR + 1];
+    size_t          req_len;
+    uint64_t        sent_ns;
+    int             tries;
+    struct v2_board board;
+    // bot
+    int             active;
+    int             letter;     // last guess, 0..25
+    int             won;
+    uint32_t        guessed;
+    struct cand_set cand;
+};
+
+static int udp_send(int fd, struct udp_game *g, uint8_t op, int letter) {
+    g->seq++;
+    udp_put_hdr(g->req, op, g->seq, g->token);
+    g->req_len = UDP_HDR;
+    if (op == UDP_GUESS) g->req[g->req_len++] = (unsigned char)letter;
+    g->tries   = 0;
+    g->sent_ns = mono_ns();
+    return send(fd, g->req, g->req_len, 0) < 0 ? -1 : 0;
+}
+
+// Walk the v2 frames of a reply, calling fn on each packet. Returns the
+// last packet kind seen, or -1 on a malformed reply.
+static int udp_frames(const unsigned char *p, size_t len, struct v2_board *b,
+                      void (*fn)(const struct server_packet *, void *), void *arg)
+{
+    const unsigned char *end = p + len;
+    int last = 0;
+    while (p < end) {
+        unsigned char type = *p++;
+        uint32_t n;
+        if (varint_get(&p, end, &n) < 0 || n > (size_t)(end - p)) return -1;
+        struct server_packet pkt;
+        int r = decode_v2(type, p, n, b, &pkt);
+        if (r < 0) return -1;
+        if (r > 0) {
+            last = r;
+            if (fn) fn(&pkt, arg);
+        }
+        p += n;
+    }
+    return last;
+}
+
+static void print_cb(const struct server_packet *pkt, void *arg) {
+    (void)arg;
+    print_packet(pkt);
+}
+
+// Send a request and wait for its reply, retransmitting as needed.
+// Returns the reply payload length (after the header), or -1.
+static int udp_exchange(int fd, struct udp_game *g, uint8_t op, int letter,
+                        unsigned char *reply, size_t cap)
+{
+    if (udp_send(fd, g, op, letter) < 0) return -1;
+    for (;;) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int r = poll(&pfd, 1, UDP_RETRANSMIT_MS);
+        if (r < 0) return -1;
+        if (r == 0) {
+            if (++g->tries > UDP_RETRIES) {
+                fprintf(stderr, "Error: no reply from server\n");
+                return -1;
             }
+            (void)send(fd, g->req, g->req_len, 0);
+            continue;
         }
-        printf("\n");
+        ssize_t n = recv(fd, reply, cap, 0);
+        uint8_t rop;
+        uint32_t seq;
+        uint64_t token;
+        if (n < 0 || udp_get_hdr(reply, (size_t)n, &rop, &seq, &token) < 0) continue;
+        if (rop != UDP_REPLY || token != g->token || seq != g->seq) continue;   // stale
+        memmove(reply, reply + UDP_HDR, (size_t)n - UDP_HDR);
+        return (int)(n - UDP_HDR);
+    }
+}
 
-        // Print incorrect guesses line
-        printf(">>>Incorrect Guesses:");
-        if (num_incorrect > 0) {
-            printf(" ");
-            for (unsigned char j = 0; j < num_incorrect; j++) {
-                printf("%c", incorrect[j]);
-                if (j + 1 < num_incorrect) {
-                    printf(" ");
+// Interactive game over UDP: same prompts as the TCP game.
+static int run_udp_game(const char *server_ip, int server_port) {
+    int fd = udp_socket(server_ip, server_port);
+    if (fd < 0) return 1;
+
+    struct udp_game g;
+    memset(&g, 0, sizeof(g));
+    g.token = udp_token(0);
+
+    unsigned char reply[UDP_DGRAM_MAX];
+    int n = udp_exchange(fd, &g, UDP_HELLO, 0, reply, sizeof(reply));
+    int r = n < 0 ? -1 : udp_frames(reply, (size_t)n, &g.board, print_cb, NULL);
+
+    char line[128];
+    while (r > 0 && r != PKT_GAME_OVER) {
+        printf(">>>Letter to guess: ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin)) break;
+        size_t len = strcspn(line, "\n");
+        if (len == 0) break;
+        int hint = len == 1 && line[0] == '?';
+        if (!hint && (len != 1 || !isalpha((unsigned char)line[0]))) {
+            printf(">>>Error! Please guess one letter.\n");
+            continue;
+        }
+        n = udp_exchange(fd, &g, hint ? UDP_HINT : UDP_GUESS,
+                         tolower((unsigned char)line[0]), reply, sizeof(reply));
+        r = n < 0 ? -1 : udp_frames(reply, (size_t)n, &g.board, print_cb, NULL);
+    }
+
+    // Let the server free the game now rather than after it lingers.
+    udp_put_hdr(reply, UDP_BYE, g.seq + 1, g.token);
+    (void)send(fd, reply, UDP_HDR, 0);
+    close(fd);
+    return r < 0 ? 1 : 0;
+}
+
+struct udp_bot_step {
+    struct udp_game *g;
+    int              over;
+};
+
+static void bot_cb(const struct server_packet *pkt, void *arg) {
+    struct udp_bot_step *st = arg;
+    if (pkt->status == V2_ST_WIN) st->g->won = 1;
+    if (pkt->kind == PKT_GAME_OVER) st->over = 1;
+}
+
+// Bot over UDP with parallel games in flight on one socket.
+static int run_udp_bot(const char *server_ip, int server_port, long games,
+                       int parallel, const char *words_file)
+{
+    load_words(words_file);
+    struct word_index ix;
+    if (index_build(&ix) < 0) {
+        perror("index_build");
+        return 1;
+    }
+    int fd = udp_socket(server_ip, server_port);
+    if (fd < 0) return 1;
+
+    if (parallel < 1) parallel = 1;
+    if (parallel > 4096) parallel = 4096;
+    struct udp_game *gs = calloc((size_t)parallel, sizeof(*gs));
+    if (!gs) {
+        perror("calloc");
+        return 1;
+    }
+
+    struct bot_stats st = {0};
+    long started = 0, failed = 0;
+    uint64_t t0 = mono_ns();
+
+    for (int i = 0; i < parallel && (games == 0 || started < games); i++, started++) {
+        gs[i].token  = udp_token((unsigned)i);
+        gs[i].active = 1;
+        (void)udp_send(fd, &gs[i], UDP_HELLO, 0);
+    }
+
+    int in_flight = (int)started;
+    unsigned char buf[UDP_DGRAM_MAX];
+    while (in_flight > 0) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int pr = poll(&pfd, 1, UDP_RETRANSMIT_MS / 4);
+        if (pr < 0) break;
+
+        // Drain every reply that is waiting.
+        ssize_t n;
+        while (pr > 0 && (n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            uint8_t op;
+            uint32_t seq;
+            uint64_t token;
+            if (udp_get_hdr(buf, (size_t)n, &op, &seq, &token) < 0 || op != UDP_REPLY) continue;
+            struct udp_game *g = &gs[(token & 0xffff) % (unsigned)parallel];
+            if (!g->active || token != g->token || seq != g->seq) continue;
+
+            struct udp_bot_step step = { g, 0 };
+            int r = udp_frames(buf + UDP_HDR, (size_t)n - UDP_HDR, &g->board, bot_cb, &step);
+            int next = -1;
+            if (r == PKT_BOARD) {
+                if (g->seq == 1) {
+                    if (cand_init_len(&g->cand, &ix, g->board.word_len) < 0) r = -1;
+                } else {
+                    uint16_t mask = 0;
+                    for (unsigned char i = 0; i < g->board.word_len; i++) {
+                        if (g->board.masked[i] == 'a' + g->letter) mask |= (uint16_t)(1u << i);
+                    }
+                    if (mask == 0) st.misses++;
+                    cand_filter(&g->cand, g->letter, mask);
                 }
+                if (r > 0) next = bot_pick(&g->cand, &g->guessed);
             }
+            if (next >= 0) {
+                g->letter = next;
+                (void)udp_send(fd, g, UDP_GUESS, 'a' + next);
+                continue;
+            }
+
+            // Game over (or broken): count it, say goodbye, start the next.
+            if (step.over) {
+                st.games++;
+                if (g->won) st.wins++; else st.losses++;
+            } else {
+                failed++;
+            }
+            udp_put_hdr(buf, UDP_BYE, g->seq + 1, g->token);
+            (void)send(fd, buf, UDP_HDR, 0);
+            if (g->seq > 1) cand_free(&g->cand);
+            unsigned slot = (unsigned)(g - gs);
+            memset(g, 0, sizeof(*g));
+            if (games == 0 || started < games) {
+                started++;
+                g->token  = udp_token(slot);
+                g->active = 1;
+                (void)udp_send(fd, g, UDP_HELLO, 0);
+            } else {
+                in_flight--;
+            }
+        }
+
+        // Retransmit whatever has waited too long.
+        uint64_t now = mono_ns();
+        for (int i = 0; i < parallel; i++) {
+            struct udp_game *g = &gs[i];
+            if (!g->active || now - g->sent_ns < UDP_RETRANSMIT_MS * 1000000ull) continue;
+            if (++g->tries > UDP_RETRIES) {
+                failed++;
+                if (g->seq > 1) cand_free(&g->cand);
+                memset(g, 0, sizeof(*g));
+                in_flight--;
+                continue;
+            }
+            g->sent_ns = now;
+            (void)send(fd, g->req, g->req_len, 0);
+        }
+    }
+
+    double elapsed = (double)(mono_ns() - t0) / 1e9;
+    printf("games %ld, wins %ld, losses %ld, failed %ld (udp, %d in flight)\n",
+           st.games, st.wins, st.losses, failed, parallel);
+    printf("avg misses %.2f, %.1f games/s\n",
+           st.games ? (double)st.misses / (double)st.games : 0.0,
+           elapsed > 0 ? (double)st.games / elapsed : 0.0);
+
+    free(gs);
+    close(fd);
+    index_free(&ix);
+    return failed ? 1 : 0;
+}
+
+// ---------- room mode ----------
+//
+// Other players' guesses arrive at any time, so wait on the socket and
+// stdin together instead of strictly alternating guess and board.
+
+static int run_room_loop(int sockfd) {
+    char line[128];
+    int prompt = 1;
+
+    for (;;) {
+        if (prompt) {
+            printf(">>>Letter to guess: ");
+            fflush(stdout);
+            prompt = 0;
         }
-        printf("\n");
 
-        // Blank line with >>>
-        printf(">>>\n");
+        struct pollfd fds[2] = {
+            { .fd = sockfd,       .events = POLLIN },
+            { .fd = STDIN_FILENO, .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            perror("poll");
+            return 1;
+        }
 
-        return 3;  // game-control
+        if (fds[0].revents) {
+            printf("\n");
+            int r = recv_and_print_one_packet(sockfd);
+            if (r < 0) return 1;
+            if (r == PKT_GAME_OVER) return 0;
+            prompt = 1;
+        }
+
+        if (fds[1].revents) {
+            if (!fgets(line, sizeof(line), stdin)) return 0;
+
+            size_t len = strcspn(line, "\n");
+            if (len == 0) return 0;   // blank line => quit
+
+            unsigned char frame[2] = { 0, 0 };
+            if (len == 1 && line[0] == '?') {
+                // hint request: empty frame
+            } else if (len == 1 && isalpha((unsigned char)line[0])) {
+                frame[0] = 1;
+                frame[1] = (unsigned char)tolower((unsigned char)line[0]);
+            } else {
+                printf(">>>Error! Please guess one letter.\n");
+                prompt = 1;
+                continue;
+            }
+            if (send_all(sockfd, (char *)frame, 1 + (size_t)frame[0]) < 0) {
+                perror("send guess");
+                return 1;
+            }
+        }
     }
 }
 
 // ---------- main ----------
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <server_ip> <server_port>\n", argv[0]);
+    if (argc >= 4 && argc <= 6 && strcmp(argv[3], "--bot") == 0) {
+        long games = argc > 4 ? atol(argv[4]) : 100;
+        const char *words_file = argc > 5 ? argv[5] : "hangman_words.txt";
+        return run_bot(argv[1], atoi(argv[2]), games, words_file);
+    }
+    if (argc >= 4 && argc <= 7 && strcmp(argv[3], "--udp-bot") == 0) {
+        long games = argc > 4 ? atol(argv[4]) : 100;
+        int parallel = argc > 5 ? atoi(argv[5]) : 32;
+        const char *words_file = argc > 6 ? argv[6] : "hangman_words.txt";
+        return run_udp_bot(argv[1], atoi(argv[2]), games, parallel, words_file);
+    }
+    if (argc == 4 && strcmp(argv[3], "--udp") == 0) {
+        return run_udp_game(argv[1], atoi(argv[2]));
+    }
+
+    // Start command: NULL for a normal game, else the start-frame payload.
+    char start_cmd[64];
+    const char *start = NULL;
+    int interactive = 1;    // prompt for guesses (rooms, races, tournaments) or just print
+    if (argc == 5 && strcmp(argv[3], "--room") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%lu",
+                 START_JOIN_ROOM, strtoul(argv[4], NULL, 10));
+        start = start_cmd;
+    } else if ((argc == 4 || argc == 5) && strcmp(argv[3], "--race") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%d", START_MATCH,
+                 argc == 5 ? atoi(argv[4]) : MM_DEFAULT_RATING);
+        start = start_cmd;
+    } else if (argc == 5 && strcmp(argv[3], "--name") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%s", START_PLAYER, argv[4]);
+        start = start_cmd;
+    } else if (argc == 4 && strcmp(argv[3], "--keep") == 0) {
+        // Resumable: the server answers with a token for --resume.
+        snprintf(start_cmd, sizeof(start_cmd), "%c", START_RESUME);
+        start = start_cmd;
+    } else if (argc == 5 && strcmp(argv[3], "--resume") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%.20s", START_RESUME, argv[4]);
+        start = start_cmd;
+    } else if (argc == 5 && strcmp(argv[3], "--rank") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%s", START_RANK, argv[4]);
+        start = start_cmd;
+        interactive = 0;
+    } else if (argc == 5 && strcmp(argv[3], "--tourney") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%lu",
+                 START_TOURNEY, strtoul(argv[4], NULL, 10));
+        start = start_cmd;
+    } else if (argc == 6 && strcmp(argv[3], "--watch") == 0 &&
+               (strcmp(argv[4], "room") == 0 || strcmp(argv[4], "session") == 0)) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c%c%lu", START_WATCH,
+                 argv[4][0] == 'r' ? FEED_ROOM : FEED_SESSION,
+                 strtoul(argv[5], NULL, 10));
+        start = start_cmd;
+        interactive = 0;
+    } else if (argc == 4 && strcmp(argv[3], "--stats") == 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "%c", START_STATS);
+        start = start_cmd;
+        interactive = 0;
+    } else if (argc != 3) {
+        fprintf(stderr, "Usage: %s <server_ip> <server_port> "
+                        "[--bot [games] [words_file] | --udp | --udp-bot [games] [parallel] [words_file] | "
+                        "--room <id> | --race [rating] | "
+                        "--name <name> | --keep | --resume <token> | --rank <name> | --tourney <id> | "
+                        "--watch room|session <id> | --stats]\n", argv[0]);
         return 1;
     }
 
     const char *server_ip = argv[1];
     int server_port = atoi(argv[2]);
 
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = connect_to_server(server_ip, server_port);
     if (sockfd < 0) {
-        perror("socket");
-        return 1;
-    }
-
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family      = AF_INET;
-    server_addr.sin_port        = htons(server_port);
-    server_addr.sin_addr.s_addr = inet_addr(server_ip);
-
-    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("connect");
-        close(sockfd);
         return 1;
     }
 
@@ -189,6 +976,19 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    if (!interactive) {
+        // Spectator / stats: no prompts, just print every frame until Game Over.
+        if (send_start(sockfd, start, 0) < 0) {
+            perror("send start");
+            close(sockfd);
+            return 1;
+        }
+        while ((r = recv_and_print_one_packet(sockfd)) > 0 && r != PKT_GAME_OVER) {
+        }
+        close(sockfd);
+        return r < 0 ? 1 : 0;
+    }
+
     // Accepted. Ask user if they want to start.
     char line[128];
     printf(">>> Ready to start game? (y/n): ");
@@ -204,14 +1004,22 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    // Send empty start message: [msg_len = 0]
-    unsigned char msg_len = 0;
-    if (send_all(sockfd, (char *)&msg_len, 1) < 0) {
+    // Send start message: empty [msg_len = 0], or a start command. Solo
+    // games speak v2; the hub's rooms and races are v1 only.
+    int solo = !start || start[0] == START_PLAYER || start[0] == START_RESUME;
+    if (send_start(sockfd, start, solo) < 0) {
         perror("send start");
         close(sockfd);
         return 1;
     }
 
+    if (!solo) {
+        // Rooms and races: boards and messages arrive on their own schedule.
+        r = run_room_loop(sockfd);
+        close(sockfd);
+        return r;
+    }
+
     // Receive initial game-control packet and any messages before it.
     for (;;) {
         r = recv_and_print_one_packet(sockfd);
@@ -233,7 +1041,8 @@ int main(int argc, char *argv[]) {
 
     int game_over = 0;
 
-    // Guess loop: blank line => quit (even if game not finished).
+    // Guess loop: blank line => quit (even if game not finished),
+    // "?" => hint.
     while (!game_over) {
         printf(">>>Letter to guess: ");
         fflush(stdout);
@@ -255,6 +1064,19 @@ int main(int argc, char *argv[]) {
             break;
         }
 
+        // "?" => ask the server for a hint (empty frame), print its reply
+        if (len == 1 && line[0] == '?') {
+            unsigned char hint_len = 0;
+            if (send_all(sockfd, (char *)&hint_len, 1) < 0) {
+                perror("send hint");
+                break;
+            }
+            if (recv_and_print_one_packet(sockfd) < 0) {
+                break;
+            }
+            continue;
+        }
+
         // must be *exactly* one alphabetic char
         if (len != 1 || !isalpha((unsigned char)line[0])) {
             printf(">>>Error! Please guess one letter.\n");
@@ -0,0 +1,83 @@
+#include "hangman_dict.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+char (*words)[MAX_WORD_LEN + 1];
+int  num_words = 0;
+static int cap_words = 0;
+
+uint16_t (*letter_pos)[26];
+uint32_t *word_letters;
+
+// load word list (normally hangman_words.txt)
+void load_words(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        exit(1);
+    }
+
+    char line[256];
+    while (num_words < MAX_WORDS && fgets(line, sizeof(line), f)) {
+        // strip newline
+        char *p = line;
+        while (*p && *p != '\n' && *p != '\r') p++;
+        *p = '\0';
+
+        size_t len = strlen(line);
+        if (len == 0) continue;
+        if (len > MAX_WORD_LEN) continue;
+
+        int ok = 1;
+        for (size_t i = 0; i < len; i++) {
+            if (!isalpha((unsigned char)line[i])) {
+                ok = 0;
+                break;
+            }
+        }
+        if (!ok) continue;
+
+        if (num_words == cap_words) {
+            int new_cap = cap_words ? cap_words * 2 : 1024;
+            void *p2 = realloc(words, (size_t)new_cap * sizeof(*words));
+            if (!p2) {
+                perror("realloc words");
+                exit(1);
+            }
+            words = p2;
+            cap_words = new_cap;
+        }
+
+        // store lowercase version
+        for (size_t i = 0; i < len; i++) {
+            words[num_words][i] = (char)tolower((unsigned char)line[i]);
+        }
+        words[num_words][len] = '\0';
+        num_words++;
+    }
+
+    fclose(f);
+
+    if (num_words == 0) {
+        fprintf(stderr, "No valid words loaded from %s\n", filename);
+        exit(1);
+    }
+
+    letter_pos   = calloc((size_t)num_words, sizeof(*letter_pos));
+    word_letters = calloc((size_t)num_words, sizeof(*word_letters));
+    if (!letter_pos || !word_letters) {
+        perror("calloc letter_pos");
+        exit(1);
+    }
+    for (int w = 0; w < num_words; w++) {
+        for (int i = 0; words[w][i]; i++) {
+            int c = words[w][i] - 'a';
+            letter_pos[w][c] |= (uint16_t)(1u << i);
+            word_letters[w]  |= 1u << c;
+        }
+    }
+}
+
@@ -0,0 +1,26 @@
+#ifndef HANGMAN_DICT_H
+#define HANGMAN_DICT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_WORDS     (1 << 20)
+#define MAX_WORD_LEN  16   // per spec
+
+// Number of uint64_t blocks in a bitset with one bit per word.
+#define BITSET_WORDS(n) (((size_t)(n) + 63) / 64)
+
+extern char (*words)[MAX_WORD_LEN + 1]; // +1 for '\0'
+extern int  num_words;
+
+// letter_pos[w][c] has bit i set when words[w][i] == 'a' + c.
+extern uint16_t (*letter_pos)[26];
+
+// word_letters[w] has bit c set when 'a' + c occurs anywhere in words[w].
+extern uint32_t *word_letters;
+
+// Load lowercase alphabetic words (1..MAX_WORD_LEN letters) from filename.
+// Exits on failure or if no word is usable.
+void load_words(const char *filename);
+
+#endif
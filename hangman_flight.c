@@ -0,0 +1,138 @@
+#define _GNU_SOURCE     // gettid
+#include "hangman_flight.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_stats.h"
+
+struct fr_ring {
+    struct fr_header hdr;
+    struct fr_entry  ring[FR_ENTRIES];
+    uint32_t         session;
+    char             dump_path[64];     // built up front: no snprintf in a handler
+};
+
+// The process's own ring, and one per thread that asked for it (NULL
+// until published); a dump writes them all.
+static struct fr_ring                  main_ring;
+static struct fr_ring                 *rings[1 + FR_THREADS] = { &main_ring };
+static int                             n_claimed = 1;
+static _Thread_local struct fr_ring   *mine = &main_ring;
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int dump_ring(const struct fr_ring *r) {
+    int fd = open(r->dump_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    int rc = write_all(fd, &r->hdr, sizeof(r->hdr)) < 0 ||
+             write_all(fd, r->ring, sizeof(r->ring)) < 0 ? -1 : 0;
+    close(fd);
+    return rc;
+}
+
+int fr_dump(void) {
+    int saved = errno;
+    int rc = 0;
+    for (int i = 0; i < 1 + FR_THREADS; i++) {
+        const struct fr_ring *r = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        if (r && dump_ring(r) < 0) rc = -1;
+    }
+    errno = saved;
+    return rc;
+}
+
+static void on_usr1(int sig) {
+    (void)sig;
+    (void)fr_dump();
+}
+
+static void on_fatal(int sig) {
+    // SA_RESETHAND restored the default action; let it finish the job.
+    (void)fr_dump();
+    raise(sig);
+}
+
+static void ring_reset(struct fr_ring *r, uint32_t id, uint32_t session, uint64_t clock_hz) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    memset(r, 0, sizeof(*r));
+    r->hdr.magic            = FR_MAGIC;
+    r->hdr.version          = FR_VERSION;
+    r->hdr.pid              = id;
+    r->hdr.entries          = FR_ENTRIES;
+    r->hdr.clock_hz         = clock_hz;
+    r->hdr.base_ticks       = stats_clock();
+    r->hdr.base_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    r->session              = session;
+    snprintf(r->dump_path, sizeof(r->dump_path), "hangman_flight.%u.bin", id);
+}
+
+void fr_init(uint32_t session, uint64_t clock_hz) {
+    // A forked child starts over with its own ring; the threads that had
+    // rings stayed behind in the parent.
+    ring_reset(&main_ring, (uint32_t)getpid(), session, clock_hz);
+    memset(rings + 1, 0, sizeof(rings) - sizeof(rings[0]));
+    n_claimed = 1;
+    mine      = &main_ring;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = on_usr1;
+    sa.sa_flags   = SA_RESTART;
+    (void)sigaction(SIGUSR1, &sa, NULL);
+
+    sa.sa_handler = on_fatal;
+    sa.sa_flags   = SA_RESETHAND;
+    int fatal[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    for (size_t i = 0; i < sizeof(fatal) / sizeof(fatal[0]); i++) {
+        (void)sigaction(fatal[i], &sa, NULL);
+    }
+}
+
+int fr_thread_init(void) {
+    int k = __atomic_fetch_add(&n_claimed, 1, __ATOMIC_RELAXED);
+    if (k >= 1 + FR_THREADS) return -1;
+    struct fr_ring *r = malloc(sizeof(*r));
+    if (!r) return -1;
+    ring_reset(r, (uint32_t)gettid(), 0, main_ring.hdr.clock_hz);
+    __atomic_store_n(&rings[k], r, __ATOMIC_RELEASE);
+    mine = r;
+    return 0;
+}
+
+void fr_set_session(uint32_t session) {
+    mine->session = session;
+}
+
+uint64_t fr_record(enum fr_type type, const void *data, size_t len) {
+    struct fr_ring *r = mine;
+    struct fr_entry *e = &r->ring[r->hdr.head % FR_ENTRIES];
+    e->ticks   = stats_clock();
+    e->session = r->session;
+    e->type    = (uint8_t)type;
+    e->len     = (uint16_t)(len > UINT16_MAX ? UINT16_MAX : len);
+    if (data) memcpy(e->data, data, len < FR_PAYLOAD ? len : FR_PAYLOAD);
+    r->hdr.head++;
+    return e->ticks;
+}
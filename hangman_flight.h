@@ -0,0 +1,83 @@
+#ifndef HANGMAN_FLIGHT_H
+#define HANGMAN_FLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Flight recorder: the last FR_ENTRIES protocol frames of this process,
+// always on.
+//
+// Each process (parent, hub, every game child) owns a static ring of
+// fixed-size entries: a cycle-counter timestamp, the session id, the
+// frame type and up to FR_PAYLOAD bytes of the frame. A worker thread
+// (--workers) records into a ring of its own, tagged per frame with the
+// session it is serving. Recording is a timestamp read and a memcpy;
+// every ring has one writer, so there is nothing to lock. On SIGUSR1
+// each ring is written to hangman_flight.<pid or tid>.bin in the working
+// directory and the process carries on; on SIGSEGV, SIGBUS, SIGFPE,
+// SIGILL or SIGABRT they are written and the signal is re-raised. The
+// dump uses only open/write/close, so it is safe in a handler; a frame
+// a worker is recording while another thread dumps may come out torn.
+//
+// hangman_flight_decode turns a dump back into readable frames.
+//
+//   kill -USR1 -<server pgid>      dump every process of the server
+
+#define FR_ENTRIES  256
+#define FR_PAYLOAD  112
+#define FR_MAGIC    0x52464d48u     // "HMFR"
+#define FR_VERSION  1
+#define FR_THREADS  16              // thread rings per process
+
+enum fr_type {
+    FR_START,           // client -> server start frame (payload = command)
+    FR_GUESS,           // client -> server guess (payload = letter)
+    FR_HINT,            // client -> server hint request
+    FR_OTHER,           // client -> server frame of another length (not kept)
+    FR_SENT,            // server -> client bytes (one or more packets)
+};
+
+struct fr_entry {
+    uint64_t      ticks;            // stats_clock()
+    uint32_t      session;
+    uint8_t       type;
+    uint8_t       pad;
+    uint16_t      len;              // frame length; > FR_PAYLOAD = truncated
+    unsigned char data[FR_PAYLOAD];
+};
+
+struct fr_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pid;                   // thread id for a thread's ring
+    uint32_t entries;               // FR_ENTRIES
+    uint64_t clock_hz;              // ticks per second
+    uint64_t base_ticks;            // ticks at base_realtime_ns
+    uint64_t base_realtime_ns;      // CLOCK_REALTIME at fr_init
+    uint64_t head;                  // frames recorded so far
+};
+// File layout: struct fr_header, then FR_ENTRIES struct fr_entry; entry
+// i holds frame number n where n % FR_ENTRIES == i.
+
+// (Re)start recording for this process: clear the ring, stamp session,
+// and install the dump handlers. Call again in each forked child.
+// clock_hz is the stats_clock() rate (0 = unknown).
+void fr_init(uint32_t session, uint64_t clock_hz);
+
+// Give the calling thread a ring of its own (after fr_init). 0 on
+// success, -1 if FR_THREADS are taken or memory is short; the thread
+// then records into the process's ring.
+int fr_thread_init(void);
+
+// Tag this thread's next frames with session.
+void fr_set_session(uint32_t session);
+
+// Record one frame of len bytes; data may be NULL to keep only the length.
+// Returns the stats_clock() stamp it recorded, so callers timing the same
+// moment need not read the clock again.
+uint64_t fr_record(enum fr_type type, const void *data, size_t len);
+
+// Write the ring now. 0 on success, -1 on error. Async-signal-safe.
+int fr_dump(void);
+
+#endif
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hangman_flight.h"
+#include "hangman_proto.h"
+
+// Decoder for flight-recorder dumps (hangman_flight.<pid>.bin): prints the
+// recorded frames oldest first, with server -> client bytes split back
+// into send_message_packet / send_game_state packets (or v2 frames, once
+// the session's start frame asked for them).
+
+static void print_time(const struct fr_header *h, uint64_t ticks) {
+    if (!h->clock_hz) {
+        printf("%20llu", (unsigned long long)ticks);
+        return;
+    }
+    // ticks are taken after base_ticks, so the delta is never negative.
+    double since = (double)(ticks - h->base_ticks) / (double)h->clock_hz;
+    uint64_t ns = h->base_realtime_ns + (uint64_t)(since * 1e9);
+    time_t sec = (time_t)(ns / 1000000000ull);
+    struct tm tm;
+    char buf[32];
+    gmtime_r(&sec, &tm);
+    strftime(buf, sizeof(buf), "%H:%M:%S", &tm);
+    printf("%s.%06lluZ", buf, (unsigned long long)(ns / 1000 % 1000000));
+}
+
+static void print_text(const unsigned char *p, size_t len) {
+    putchar('"');
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] >= 32 && p[i] < 127 && p[i] != '"') putchar(p[i]);
+        else printf("\\x%02x", p[i]);
+    }
+    putchar('"');
+}
+
+// Walk the packets in one send: [flag > 0][text] or [0][wl][ni][masked][incorrect].
+static void print_sent(const unsigned char *p, size_t len, int truncated) {
+    size_t off = 0;
+    while (off < len) {
+        unsigned char flag = p[off];
+        if (flag > 0) {
+            size_t n = len - off - 1 < flag ? len - off - 1 : flag;
+            printf("\n      message ");
+            print_text(p + off + 1, n);
+            off += 1 + (size_t)flag;
+        } else {
+            if (len - off < 3) break;
+            unsigned wl = p[off + 1], ni = p[off + 2];
+            size_t have = len - off - 3;
+            printf("\n      board   ");
+            for (unsigned i = 0; i < wl && i < have; i++) {
+                printf("%s%c", i ? " " : "", p[off + 3 + i]);
+            }
+            printf("  incorrect: ");
+            for (unsigned i = 0; i < ni && wl + i < have; i++) {
+                printf("%c", p[off + 3 + wl + i]);
+            }
+            if (ni == 0) printf("-");
+            off += 3 + wl + ni;
+        }
+    }
+    if (truncated) printf("\n      ... (truncated)");
+}
+
+// Same for a v2 send: [type][varint len][payload] frames.
+static void print_sent_v2(const unsigned char *p, size_t len, int truncated) {
+    static const char *const status[] = { "?", "win", "lose", "game over" };
+    const unsigned char *end = p + len;
+    while (p < end) {
+        unsigned char type = *p++;
+        uint32_t n;
+        if (varint_get(&p, end, &n) < 0) break;
+        size_t have = (size_t)(end - p) < n ? (size_t)(end - p) : n;
+        if (type == V2_TEXT) {
+            printf("\n      text    ");
+            print_text(p, have);
+        } else if (type == V2_BOARD && have >= 1) {
+            unsigned wl = p[0];
+            printf("\n      board   ");
+            for (unsigned i = 0; i < wl && 1 + i < have; i++) {
+                printf("%s%c", i ? " " : "", p[1 + i]);
+            }
+            printf("  incorrect: ");
+            if (n <= 1 + wl) printf("-");
+            for (size_t i = 1 + wl; i < have; i++) printf("%c", p[i]);
+        } else if (type == V2_STATUS) {
+            const unsigned char *q = p;
+            uint32_t code;
+            if (varint_get(&q, p + have, &code) == 0) {
+                printf("\n      status  %s", code < 4 ? status[code] : "?");
+            }
+        } else if (type == V2_REVEAL && have == 3) {
+            printf("\n      reveal  '%c' mask 0x%04x", p[0], p[1] | p[2] << 8);
+        } else if (type == V2_MISS && have == 1) {
+            printf("\n      miss    '%c'", p[0]);
+        } else if (type == V2_WORD) {
+            printf("\n      word    ");
+            print_text(p, have);
+        } else if (type == V2_HINT) {
+            if (have) printf("\n      hint    '%c'", p[0]);
+            else printf("\n      hint    none");
+        } else {
+            printf("\n      type %u, %u bytes", type, n);
+        }
+        if (have < n) break;
+        p += n;
+    }
+    if (truncated) printf("\n      ... (truncated)");
+}
+
+static int decode(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    struct fr_header h;
+    static struct fr_entry ring[FR_ENTRIES];
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != FR_MAGIC ||
+        h.version != FR_VERSION || h.entries != FR_ENTRIES ||
+        fread(ring, sizeof(ring), 1, f) != 1) {
+        fprintf(stderr, "%s: not a flight-recorder dump (or wrong version)\n", path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    uint64_t first = h.head > FR_ENTRIES ? h.head - FR_ENTRIES : 0;
+    printf("== %s: pid %u, %llu frames recorded, showing %llu\n", path, h.pid,
+           (unsigned long long)h.head, (unsigned long long)(h.head - first));
+
+    int v2 = 0;     // a game child serves one session
+    for (uint64_t n = first; n < h.head; n++) {
+        const struct fr_entry *e = &ring[n % FR_ENTRIES];
+        size_t kept = e->len < FR_PAYLOAD ? e->len : FR_PAYLOAD;
+        print_time(&h, e->ticks);
+        printf("  session %-7u ", e->session);
+        switch (e->type) {
+        case FR_START:
+            printf("<- start   ");
+            if (e->len == 0) printf("(empty: solo game)");
+            else print_text(e->data, kept);
+            v2 = e->len > 0 && e->data[0] == START_V2;
+            break;
+        case FR_GUESS:
+            printf("<- guess   '%c'", e->data[0]);
+            break;
+        case FR_HINT:
+            printf("<- hint");
+            break;
+        case FR_OTHER:
+            printf("<- frame   len %u (ignored)", e->len);
+            break;
+        case FR_SENT:
+            printf("-> %u bytes", e->len);
+            if (v2) print_sent_v2(e->data, kept, e->len > FR_PAYLOAD);
+            else print_sent(e->data, kept, e->len > FR_PAYLOAD);
+            break;
+        default:
+            printf("?? type %u len %u", e->type, e->len);
+        }
+        putchar('\n');
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <hangman_flight.PID.bin>...\n", argv[0]);
+        return 1;
+    }
+    int rc = 0;
+    for (int i = 1; i < argc; i++) {
+        if (decode(argv[i]) < 0) rc = 1;
+    }
+    return rc;
+}
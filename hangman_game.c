@@ -0,0 +1,140 @@
+#include "hangman_game.h"
+
+#include <string.h>
+
+void game_init(struct game *g, int word_idx) {
+    memset(g, 0, sizeof(*g));
+    g->word_idx = word_idx;
+    g->word_len = (unsigned char)strlen(words[word_idx]);
+    memset(g->masked, '_', g->word_len);
+}
+
+uint16_t game_reveal_mask(const struct game *g, unsigned char letter) {
+    if (letter >= 'a' && letter <= 'z') {
+        return letter_pos[g->word_idx][letter - 'a'];
+    }
+    return 0;
+}
+
+enum guess_result game_guess(struct game *g, unsigned char letter) {
+    const char *secret = game_secret(g);
+
+    // Check if this letter was already guessed (in masked or incorrect)
+    for (unsigned char i = 0; i < g->word_len; i++) {
+        if (g->masked[i] == (char)letter) return GUESS_REPEAT;
+    }
+    for (unsigned char j = 0; j < g->num_incorrect; j++) {
+        if (g->incorrect[j] == letter) return GUESS_REPEAT;
+    }
+
+    if (letter >= 'a' && letter <= 'z') {
+        g->guessed |= 1u << (letter - 'a');
+    }
+
+    // First time seeing this letter. Reveal every occurrence.
+    int found = 0;
+    for (unsigned char i = 0; i < g->word_len; i++) {
+        if ((unsigned char)secret[i] == letter) {
+            g->masked[i] = (char)letter;
+            found = 1;
+        }
+    }
+    if (found) return GUESS_HIT;
+
+    if (g->num_incorrect < MAX_INCORRECT) {
+        g->incorrect[g->num_incorrect++] = letter;
+    }
+    return GUESS_MISS;
+}
+
+int game_won(const struct game *g) {
+    return memchr(g->masked, '_', g->word_len) == NULL;
+}
+
+int game_lost(const struct game *g) {
+    return g->num_incorrect >= MAX_INCORRECT;
+}
+
+// ---------- sessions ----------
+
+int session_start(struct session *s, const struct word_index *ix,
+                  int word_idx, int evil)
+{
+    memset(s, 0, sizeof(*s));
+    game_init(&s->g, word_idx);
+    s->evil = evil;
+    if (evil && cand_init_len(&s->cand, ix, s->g.word_len) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+enum guess_result session_guess(struct session *s, unsigned char letter) {
+    int fresh = letter >= 'a' && letter <= 'z' &&
+                !((s->g.guessed >> (letter - 'a')) & 1);
+
+    if (fresh && s->evil) {
+        // Let the largest family decide; any survivor reveals exactly the
+        // positions that family shares, so game_guess applies unchanged.
+        cand_filter(&s->cand, letter - 'a', cand_largest_family(&s->cand, letter - 'a'));
+        s->g.word_idx = cand_first(&s->cand);
+    } else if (fresh && s->cand.bits) {
+        cand_filter(&s->cand, letter - 'a', game_reveal_mask(&s->g, letter));
+    }
+    return game_guess(&s->g, letter);
+}
+
+int session_hint(struct session *s, const struct word_index *ix) {
+    if (!s->cand.bits) {
+        uint32_t excluded = 0;
+        for (unsigned char j = 0; j < s->g.num_incorrect; j++) {
+            unsigned char c = s->g.incorrect[j];
+            if (c >= 'a' && c <= 'z') excluded |= 1u << (c - 'a');
+        }
+        if (cand_init_board(&s->cand, ix, s->g.masked, s->g.word_len, excluded) < 0) {
+            return -1;
+        }
+    }
+    int best = cand_best_letter(&s->cand, s->g.guessed);
+    return best < 0 ? 0 : 'a' + best;
+}
+
+void session_end(struct session *s) {
+    cand_free(&s->cand);
+}
+
+void session_pack(const struct session *s, struct session_pack *p) {
+    memset(p, 0, sizeof(*p));
+    p->word_idx      = s->g.word_idx;
+    p->guessed       = s->g.guessed;
+    p->num_incorrect = s->g.num_incorrect;
+    p->evil          = (unsigned char)s->evil;
+    memcpy(p->incorrect, s->g.incorrect, s->g.num_incorrect);
+}
+
+int session_unpack(struct session *s, const struct session_pack *p,
+                   const struct word_index *ix)
+{
+    memset(s, 0, sizeof(*s));
+    game_init(&s->g, p->word_idx);
+    s->evil            = p->evil;
+    s->g.guessed       = p->guessed;
+    s->g.num_incorrect = p->num_incorrect;
+    memcpy(s->g.incorrect, p->incorrect, p->num_incorrect);
+
+    const char *secret = game_secret(&s->g);
+    for (unsigned char i = 0; i < s->g.word_len; i++) {
+        int c = secret[i] - 'a';
+        if (c >= 0 && c < 26 && ((p->guessed >> c) & 1)) s->g.masked[i] = secret[i];
+    }
+    if (!s->evil) return 0;     // hints rebuild the set when first asked
+
+    // Every evil step keeps exactly the words consistent with the board,
+    // which is what the index returns for it.
+    uint32_t excluded = 0;
+    for (unsigned char j = 0; j < p->num_incorrect; j++) {
+        unsigned char c = p->incorrect[j];
+        if (c >= 'a' && c <= 'z') excluded |= 1u << (c - 'a');
+    }
+    return cand_init_board(&s->cand, ix, s->g.masked, s->g.word_len, excluded);
+}
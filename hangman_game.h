@@ -0,0 +1,87 @@
+#ifndef HANGMAN_GAME_H
+#define HANGMAN_GAME_H
+
+#include <stdint.h>
+
+#include "hangman_dict.h"
+#include "hangman_index.h"
+#include "hangman_cand.h"
+
+#define MAX_INCORRECT 8
+
+// State of one fixed-word game. The secret is words[word_idx]; the evil
+// engine may repoint word_idx between guesses as long as the new word is
+// consistent with the board.
+struct game {
+    int           word_idx;
+    unsigned char word_len;
+    unsigned char num_incorrect;
+    uint32_t      guessed;                 // bit c set once 'a' + c tried
+    char          masked[MAX_WORD_LEN];    // '_' for hidden positions
+    unsigned char incorrect[MAX_INCORRECT];
+};
+
+enum guess_result {
+    GUESS_REPEAT,   // letter already on the board or in the incorrect list
+    GUESS_HIT,
+    GUESS_MISS,
+};
+
+void game_init(struct game *g, int word_idx);
+
+// Apply one guess: reveal every occurrence of letter, or record a miss.
+enum guess_result game_guess(struct game *g, unsigned char letter);
+
+// Positions of letter (lowercase) in the secret, one bit per position.
+uint16_t game_reveal_mask(const struct game *g, unsigned char letter);
+
+int game_won(const struct game *g);
+int game_lost(const struct game *g);
+
+static inline const char *game_secret(const struct game *g) {
+    return words[g->word_idx];
+}
+
+// ---------- sessions ----------
+//
+// A game plus the candidate set behind hints and evil mode. The candidate
+// set exists from the start in evil mode (the random word only fixes the
+// length); otherwise it is built from the board on the first hint and
+// narrowed by every guess after that.
+
+struct session {
+    struct game     g;
+    struct cand_set cand;
+    int             evil;
+};
+
+// 0 on success, -1 on allocation failure.
+int session_start(struct session *s, const struct word_index *ix,
+                  int word_idx, int evil);
+
+// Apply a guess, letting the evil engine repoint the secret first.
+enum guess_result session_guess(struct session *s, unsigned char letter);
+
+// Best next letter ('a'..'z'), 0 if none is left, -1 on allocation failure.
+int session_hint(struct session *s, const struct word_index *ix);
+
+void session_end(struct session *s);
+
+// Compact form of a session, for handing it to another thread: the word,
+// the letters tried and the misses in order. The board follows from
+// those, and the candidate set is rebuilt from the board.
+struct session_pack {
+    int32_t       word_idx;
+    uint32_t      guessed;
+    unsigned char num_incorrect;
+    unsigned char evil;
+    unsigned char incorrect[MAX_INCORRECT];
+};
+
+void session_pack(const struct session *s, struct session_pack *p);
+
+// Rebuild a packed session. 0 on success, -1 on allocation failure.
+int session_unpack(struct session *s, const struct session_pack *p,
+                   const struct word_index *ix);
+
+#endif
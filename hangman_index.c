@@ -0,0 +1,123 @@
+#include "hangman_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Let the loader pick the widest popcount/AND the CPU has. The loops
+// below are plain C; the clones only change what the compiler may emit.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define INDEX_SIMD __attribute__((target_clones("arch=icelake-server", "arch=haswell", "popcnt", "default")))
+#else
+#define INDEX_SIMD
+#endif
+
+// Blocks processed per pass. 256 blocks = 2 KiB per operand, so every
+// operand sweep of a tile stays in L1.
+#define TILE_BLOCKS 256
+
+// len slot + one AND per revealed position + ANDNOT per (hidden position,
+// revealed letter) + ANDNOT per excluded letter.
+#define MAX_OPS (1 + MAX_WORD_LEN + MAX_WORD_LEN * MAX_WORD_LEN + 26)
+
+int index_build(struct word_index *ix) {
+    memset(ix->len_count, 0, sizeof(ix->len_count));
+    memset(ix->len_letter_count, 0, sizeof(ix->len_letter_count));
+    ix->nblocks = BITSET_WORDS(num_words);
+    ix->bits = calloc((size_t)INDEX_NUM_SLOTS * ix->nblocks, sizeof(uint64_t));
+    if (!ix->bits) {
+        return -1;
+    }
+
+    for (int w = 0; w < num_words; w++) {
+        size_t   b   = (size_t)w >> 6;
+        uint64_t bit = 1ull << (w & 63);
+        int i;
+        for (i = 0; words[w][i]; i++) {
+            int c = words[w][i] - 'a';
+            ix->bits[(size_t)INDEX_LETTER_SLOT(c) * ix->nblocks + b] |= bit;
+            ix->bits[(size_t)INDEX_POS_SLOT(i, c) * ix->nblocks + b] |= bit;
+        }
+        ix->bits[(size_t)INDEX_LEN_SLOT(i) * ix->nblocks + b] |= bit;
+
+        ix->len_count[i]++;
+        for (uint32_t m = word_letters[w]; m; m &= m - 1) {
+            ix->len_letter_count[i][__builtin_ctz(m)]++;
+        }
+    }
+    return 0;
+}
+
+void index_free(struct word_index *ix) {
+    free(ix->bits);
+    ix->bits = NULL;
+    ix->nblocks = 0;
+}
+
+INDEX_SIMD
+size_t bitset_count(const uint64_t *bits, size_t nblocks) {
+    size_t total = 0;
+    for (size_t b = 0; b < nblocks; b++) {
+        total += (size_t)__builtin_popcountll(bits[b]);
+    }
+    return total;
+}
+
+INDEX_SIMD
+size_t index_match(const struct word_index *ix, const char *pattern,
+                   size_t len, uint32_t excluded, uint64_t *out)
+{
+    if (len == 0 || len > MAX_WORD_LEN) return 0;
+
+    const uint64_t *and_ops[1 + MAX_WORD_LEN];
+    const uint64_t *andnot_ops[MAX_OPS];
+    int nand = 0, nandnot = 0;
+
+    uint32_t revealed = 0;
+    and_ops[nand++] = index_slot(ix, INDEX_LEN_SLOT((int)len));
+    for (size_t i = 0; i < len; i++) {
+        if (pattern[i] != '_') {
+            int c = pattern[i] - 'a';
+            if (c < 0 || c >= 26) return 0;
+            revealed |= 1u << c;
+            and_ops[nand++] = index_slot(ix, INDEX_POS_SLOT((int)i, c));
+        }
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (pattern[i] != '_') continue;
+        for (uint32_t r = revealed; r; r &= r - 1) {
+            int c = __builtin_ctz(r);
+            andnot_ops[nandnot++] = index_slot(ix, INDEX_POS_SLOT((int)i, c));
+        }
+    }
+    for (uint32_t e = excluded & ((1u << 26) - 1); e; e &= e - 1) {
+        andnot_ops[nandnot++] = index_slot(ix, INDEX_LETTER_SLOT(__builtin_ctz(e)));
+    }
+
+    uint64_t scratch[TILE_BLOCKS];
+    size_t total = 0;
+    for (size_t t = 0; t < ix->nblocks; t += TILE_BLOCKS) {
+        size_t n = ix->nblocks - t;
+        if (n > TILE_BLOCKS) n = TILE_BLOCKS;
+        uint64_t *acc = out ? out + t : scratch;
+
+        memcpy(acc, and_ops[0] + t, n * sizeof(uint64_t));
+        for (int k = 1; k < nand; k++) {
+            const uint64_t *op = and_ops[k] + t;
+            for (size_t b = 0; b < n; b++) acc[b] &= op[b];
+        }
+
+        // Most tiles are empty after the positive terms; skip the rest.
+        uint64_t any = 0;
+        for (size_t b = 0; b < n; b++) any |= acc[b];
+        if (!any) continue;
+
+        for (int k = 0; k < nandnot; k++) {
+            const uint64_t *op = andnot_ops[k] + t;
+            for (size_t b = 0; b < n; b++) acc[b] &= ~op[b];
+        }
+        for (size_t b = 0; b < n; b++) {
+            total += (size_t)__builtin_popcountll(acc[b]);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,51 @@
+#ifndef HANGMAN_INDEX_H
+#define HANGMAN_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_dict.h"
+
+// Inverted letter/position index over words[]. Every entry is a bitset
+// with one bit per word, so pattern queries reduce to AND/ANDNOT sweeps.
+//
+// Layout of bits (each slot is nblocks uint64_t):
+//   [0, 26)                       words containing letter c anywhere
+//   [26, 26 + 16*26)              words with letter c at position i
+//   [26 + 16*26, + MAX_WORD_LEN+1) words of length n
+struct word_index {
+    size_t    nblocks;
+    uint64_t *bits;
+
+    // len_letter_count[n][c]: words of length n containing letter c.
+    uint32_t  len_count[MAX_WORD_LEN + 1];
+    uint32_t  len_letter_count[MAX_WORD_LEN + 1][26];
+};
+
+#define INDEX_LETTER_SLOT(c)     (c)
+#define INDEX_POS_SLOT(i, c)     (26 + (i) * 26 + (c))
+#define INDEX_LEN_SLOT(n)        (26 + MAX_WORD_LEN * 26 + (n))
+#define INDEX_NUM_SLOTS          (26 + MAX_WORD_LEN * 26 + MAX_WORD_LEN + 1)
+
+static inline const uint64_t *index_slot(const struct word_index *ix, int slot) {
+    return ix->bits + (size_t)slot * ix->nblocks;
+}
+
+// Build the index over the currently loaded words[]. 0 on success, -1 on
+// allocation failure.
+int index_build(struct word_index *ix);
+void index_free(struct word_index *ix);
+
+// Words consistent with a hangman board: pattern holds len characters,
+// '_' for hidden positions and lowercase letters for revealed ones;
+// excluded has bit c set for each letter known to be absent. A revealed
+// letter never sits behind a '_' (all occurrences are revealed at once).
+// If out is non-NULL it receives the matching bitset (nblocks long).
+// Returns the number of matching words.
+size_t index_match(const struct word_index *ix, const char *pattern,
+                   size_t len, uint32_t excluded, uint64_t *out);
+
+// Number of set bits in a bitset of nblocks blocks.
+size_t bitset_count(const uint64_t *bits, size_t nblocks);
+
+#endif
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hangman_dict.h"
+#include "hangman_index.h"
+
+// Microbenchmark for the inverted index: replays hangman-shaped pattern
+// queries (some letters revealed, some excluded) and reports queries/sec.
+
+#define NUM_PATTERNS 4096
+
+struct query {
+    char     pattern[MAX_WORD_LEN + 1];
+    size_t   len;
+    uint32_t excluded;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Build a query from a random word: reveal a random subset of its letters
+// and exclude a few letters it does not contain.
+static void make_query(struct query *q) {
+    const char *w = words[rand() % num_words];
+    uint32_t present = 0, revealed = 0;
+
+    q->len = strlen(w);
+    for (size_t i = 0; i < q->len; i++) {
+        present |= 1u << (w[i] - 'a');
+    }
+    for (uint32_t p = present; p; p &= p - 1) {
+        if (rand() & 1) revealed |= p & -p;
+    }
+    for (size_t i = 0; i < q->len; i++) {
+        q->pattern[i] = (revealed >> (w[i] - 'a')) & 1 ? w[i] : '_';
+    }
+    q->pattern[q->len] = '\0';
+
+    q->excluded = 0;
+    int misses = rand() % 6;
+    while (misses > 0) {
+        int c = rand() % 26;
+        if (!((present >> c) & 1)) {
+            q->excluded |= 1u << c;
+            misses--;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *dict = argc > 1 ? argv[1] : "hangman_words.txt";
+    long iters = argc > 2 ? atol(argv[2]) : 200000;
+
+    load_words(dict);
+
+    struct word_index ix;
+    double t0 = now_sec();
+    if (index_build(&ix) < 0) {
+        perror("index_build");
+        return 1;
+    }
+    double build = now_sec() - t0;
+
+    static struct query queries[NUM_PATTERNS];
+    srand(176);
+    for (int i = 0; i < NUM_PATTERNS; i++) {
+        make_query(&queries[i]);
+    }
+
+    uint64_t *out = malloc(ix.nblocks * sizeof(uint64_t));
+    if (!out) {
+        perror("malloc");
+        return 1;
+    }
+
+    size_t matched = 0;
+    t0 = now_sec();
+    for (long i = 0; i < iters; i++) {
+        const struct query *q = &queries[i % NUM_PATTERNS];
+        matched += index_match(&ix, q->pattern, q->len, q->excluded, out);
+    }
+    double elapsed = now_sec() - t0;
+
+    printf("words:    %d\n", num_words);
+    printf("build:    %.3f ms\n", build * 1e3);
+    printf("queries:  %ld in %.3f s\n", iters, elapsed);
+    printf("qps:      %.0f\n", (double)iters / elapsed);
+    printf("avg hits: %.1f\n", (double)matched / (double)iters);
+
+    free(out);
+    index_free(&ix);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "hangman_leader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LB_INIT_CAP 1024
+#define TREE_SIZE   (LB_MAX_SCORE + 1)
+
+int lb_init(struct leaderboard *lb) {
+    memset(lb, 0, sizeof(*lb));
+    lb->slots = calloc(LB_INIT_CAP, sizeof(*lb->slots));
+    lb->tree  = calloc(TREE_SIZE + 1, sizeof(*lb->tree));
+    if (!lb->slots || !lb->tree) {
+        lb_free(lb);
+        return -1;
+    }
+    lb->cap = LB_INIT_CAP;
+    return 0;
+}
+
+void lb_free(struct leaderboard *lb) {
+    free(lb->slots);
+    free(lb->tree);
+    memset(lb, 0, sizeof(*lb));
+}
+
+// ---------- Fenwick tree over scores ----------
+
+// Tree index i (1-based) stands for score i - 1.
+static void tree_add(struct leaderboard *lb, uint32_t score, int32_t delta) {
+    for (size_t i = (size_t)score + 1; i <= TREE_SIZE; i += i & -i) {
+        lb->tree[i] += (uint32_t)delta;
+    }
+}
+
+// Players scoring at most score.
+static size_t tree_prefix(const struct leaderboard *lb, uint32_t score) {
+    size_t sum = 0;
+    for (size_t i = (size_t)score + 1; i > 0; i -= i & -i) {
+        sum += lb->tree[i];
+    }
+    return sum;
+}
+
+size_t lb_rank(const struct leaderboard *lb, uint32_t score) {
+    if (score > LB_MAX_SCORE) score = LB_MAX_SCORE;
+    return lb->n - tree_prefix(lb, score) + 1;
+}
+
+// ---------- players ----------
+
+static uint64_t name_hash(const char *s) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ull;
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    return h;
+}
+
+static struct lb_player *slot_for(struct lb_player *slots, size_t cap, const char *name) {
+    size_t i = (size_t)name_hash(name) & (cap - 1);
+    while (slots[i].name[0] && strcmp(slots[i].name, name) != 0) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &slots[i];
+}
+
+static int grow(struct leaderboard *lb) {
+    size_t cap = lb->cap * 2;
+    struct lb_player *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+    for (size_t i = 0; i < lb->cap; i++) {
+        if (lb->slots[i].name[0]) {
+            *slot_for(slots, cap, lb->slots[i].name) = lb->slots[i];
+        }
+    }
+    free(lb->slots);
+    lb->slots = slots;
+    lb->cap = cap;
+    return 0;
+}
+
+const struct lb_player *lb_find(const struct leaderboard *lb, const char *name) {
+    if (!name[0]) return NULL;
+    const struct lb_player *p = slot_for(lb->slots, lb->cap, name);
+    return p->name[0] ? p : NULL;
+}
+
+int lb_record(struct leaderboard *lb, const char *name, int won, int misses,
+              uint64_t solve_ns) {
+    char key[LB_NAME_MAX + 1];
+    size_t len = strnlen(name, LB_NAME_MAX);
+    if (len == 0) return 0;
+    memcpy(key, name, len);
+    key[len] = '\0';
+
+    // Keep the load factor under 3/4.
+    if ((lb->n + 1) * 4 > lb->cap * 3 && grow(lb) < 0) return -1;
+
+    struct lb_player *p = slot_for(lb->slots, lb->cap, key);
+    if (!p->name[0]) {
+        memcpy(p->name, key, len + 1);
+        lb->n++;
+        tree_add(lb, 0, 1);
+    }
+
+    uint32_t old = p->score;
+    if (won) {
+        p->wins++;
+        p->solve_ns += solve_ns;
+        int points = LB_WIN_POINTS - misses;
+        if (points > 0) p->score += (uint32_t)points;
+        if (p->score > LB_MAX_SCORE) p->score = LB_MAX_SCORE;
+    } else {
+        p->losses++;
+    }
+    p->misses += (uint64_t)misses;
+
+    if (p->score != old) {
+        tree_add(lb, old, -1);
+        tree_add(lb, p->score, 1);
+    }
+    return 0;
+}
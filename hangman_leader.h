@@ -0,0 +1,47 @@
+#ifndef HANGMAN_LEADER_H
+#define HANGMAN_LEADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Leaderboard: per-player wins, losses, misses and solve time, ranked by
+// score. A win scores LB_WIN_POINTS minus the misses it took; a loss
+// scores nothing.
+//
+// Players live in an open-addressing hash table keyed by name. Ranks come
+// from a Fenwick tree counting players per score, so "how many players
+// score above s" is a prefix sum: O(log LB_MAX_SCORE) however many
+// players there are, and recording a game is two point updates.
+
+#define LB_NAME_MAX    31
+#define LB_MAX_SCORE   ((1 << 20) - 1)   // scores above this share the top bucket
+#define LB_WIN_POINTS  10
+
+struct lb_player {
+    char     name[LB_NAME_MAX + 1];    // "" = empty slot
+    uint32_t score;
+    uint32_t wins, losses;
+    uint64_t misses;
+    uint64_t solve_ns;                 // total over won games
+};
+
+struct leaderboard {
+    struct lb_player *slots;
+    size_t            cap, n;          // cap is a power of two
+    uint32_t         *tree;            // Fenwick tree over score + 1
+};
+
+int  lb_init(struct leaderboard *lb);
+void lb_free(struct leaderboard *lb);
+
+// Record one finished game for name. 0 on success, -1 on allocation failure.
+int lb_record(struct leaderboard *lb, const char *name, int won, int misses,
+              uint64_t solve_ns);
+
+// NULL if name has never finished a game.
+const struct lb_player *lb_find(const struct leaderboard *lb, const char *name);
+
+// 1-based rank of a score: one more than the players strictly above it.
+size_t lb_rank(const struct leaderboard *lb, uint32_t score);
+
+#endif
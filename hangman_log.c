@@ -0,0 +1,163 @@
+#include "hangman_log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct log_rec {
+    int32_t  a, b;
+    uint16_t ev;
+};
+
+// head is written only by the producer, tail only by the writer; each
+// sits on its own cache line so neither side's stores bounce the other's.
+struct log_ring {
+    _Alignas(64) uint64_t head;
+    _Alignas(64) uint64_t tail;
+    _Alignas(64) uint64_t dropped;      // producer: ring was full
+    struct log_rec rec[LOG_RING];
+};
+
+static struct log_ring *rings[LOG_MAX_RINGS];
+static int              nrings;
+static uint64_t         lost;           // no ring for the producer
+static __thread struct log_ring *my_ring;
+
+static struct log_ring *ring_register(void) {
+    struct log_ring *r = aligned_alloc(64, sizeof(*r));
+    if (!r) return NULL;
+    memset(r, 0, sizeof(*r));
+
+    int i = __atomic_fetch_add(&nrings, 1, __ATOMIC_RELAXED);
+    if (i >= LOG_MAX_RINGS) {
+        free(r);
+        return NULL;
+    }
+    __atomic_store_n(&rings[i], r, __ATOMIC_RELEASE);
+    my_ring = r;
+    return r;
+}
+
+void log_event(enum log_event ev, int32_t a, int32_t b) {
+    struct log_ring *r = my_ring ? my_ring : ring_register();
+    if (!r) {
+        __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint64_t head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == LOG_RING) {
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    struct log_rec *rec = &r->rec[head & (LOG_RING - 1)];
+    rec->a  = a;
+    rec->b  = b;
+    rec->ev = (uint16_t)ev;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// ---------- writer thread ----------
+
+static int log_fd = -1;
+
+static void write_all(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(log_fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;     // nowhere left to complain
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+static int format_rec(const struct log_rec *rec, char *out, size_t out_len) {
+    switch (rec->ev) {
+    case LOG_ACCEPTED:
+        return snprintf(out, out_len, "Accepted new client (session %d), active_clients = %d\n",
+                        rec->a, rec->b);
+    case LOG_REJECTED:
+        return snprintf(out, out_len, "Rejected client (server busy). active_clients = %d\n",
+                        rec->b);
+    case LOG_EXITED:
+        return snprintf(out, out_len, "Client exited, active_clients = %d\n", rec->b);
+    case LOG_DRAINING:
+        return snprintf(out, out_len, "Draining: no new clients, waiting for %d\n", rec->b);
+    case LOG_REBALANCE:
+        return snprintf(out, out_len, "Rebalancing: worker %d sheds games to worker %d\n",
+                        rec->a, rec->b);
+    case LOG_HANDOFF:
+        return snprintf(out, out_len, "Upgrade: handed %d games to pid %d\n", rec->a, rec->b);
+    case LOG_RESUMED:
+        return snprintf(out, out_len, "Upgrade: resumed %d games from pid %d\n", rec->a, rec->b);
+    case LOG_ORPHANED:
+        return snprintf(out, out_len, "Child %d crashed; %d games left to resume\n", rec->a, rec->b);
+    }
+    return 0;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    static char buf[64 * 1024];
+    uint64_t reported = 0;
+
+    for (;;) {
+        size_t len = 0;
+        uint64_t dropped = __atomic_load_n(&lost, __ATOMIC_RELAXED);
+        int n = __atomic_load_n(&nrings, __ATOMIC_RELAXED);
+        if (n > LOG_MAX_RINGS) n = LOG_MAX_RINGS;
+
+        for (int i = 0; i < n; i++) {
+            struct log_ring *r = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+            if (!r) continue;
+            uint64_t tail = r->tail;
+            uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+            for (; tail != head; tail++) {
+                if (sizeof(buf) - len < 256) {
+                    write_all(buf, len);
+                    len = 0;
+                }
+                int k = format_rec(&r->rec[tail & (LOG_RING - 1)], buf + len, sizeof(buf) - len);
+                if (k > 0) len += (size_t)k;
+            }
+            __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+            dropped += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+        }
+
+        if (dropped != reported) {
+            int k = snprintf(buf + len, sizeof(buf) - len, "log: %llu records dropped\n",
+                             (unsigned long long)(dropped - reported));
+            if (k > 0 && (size_t)k < sizeof(buf) - len) len += (size_t)k;
+            reported = dropped;
+        }
+
+        if (len > 0) {
+            write_all(buf, len);
+        } else {
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = LOG_FLUSH_MS * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+int log_start(int fd) {
+    pthread_t tid;
+    log_fd = fd;
+    // The writer blocks every signal, so they interrupt the accept loop.
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&tid, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) return -1;
+    pthread_detach(tid);
+    return 0;
+}
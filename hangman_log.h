@@ -0,0 +1,43 @@
+#ifndef HANGMAN_LOG_H
+#define HANGMAN_LOG_H
+
+#include <stdint.h>
+
+// Asynchronous event log for the accept loop.
+//
+// A producer thread writes fixed-size binary records into its own
+// single-producer/single-consumer ring: two relaxed loads, a copy and a
+// release store, no locks and no syscalls. One background thread drains
+// every ring, formats the records and writes each batch with a single
+// write(2), so a slow terminal or pipe stalls only that thread. When a
+// ring is full the record is dropped and counted; the writer reports the
+// count with the next batch.
+//
+// The writer uses write(2), never stdio, so children forked while it runs
+// cannot inherit a stdio lock held mid-printf.
+
+#define LOG_RING        4096    // records per producer ring (power of two)
+#define LOG_MAX_RINGS   8
+#define LOG_FLUSH_MS    10      // writer poll interval when idle
+
+enum log_event {
+    LOG_ACCEPTED,       // a = session (child pid), b = active clients
+    LOG_REJECTED,       // b = active clients
+    LOG_EXITED,         // a = pid, b = active clients
+    LOG_DRAINING,       // b = active clients still to finish
+    LOG_REBALANCE,      // a = busy worker told to shed load to worker b
+    LOG_HANDOFF,        // a = games passed to the upgraded server, b = its pid
+    LOG_RESUMED,        // a = games taken over from the old server, b = its pid
+    LOG_ORPHANED,       // a = pid that died mid-game, b = its games left resumable
+};
+
+// Start the writer thread, which formats lines to fd. 0 on success, -1 on error.
+int log_start(int fd);
+
+// Queue one record from the calling thread (its ring is created on first
+// use). Never blocks. Records queued before log_start wait in the ring
+// and print once the writer starts; a record is dropped, and counted,
+// only when its ring is full or no ring is left.
+void log_event(enum log_event ev, int32_t a, int32_t b);
+
+#endif
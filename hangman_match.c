@@ -0,0 +1,138 @@
+#include "hangman_match.h"
+
+#include <string.h>
+
+void mm_init(struct mm_queue *q) {
+    memset(q, 0, sizeof(*q));
+}
+
+static int rating_bucket(int rating) {
+    if (rating < MM_MIN_RATING) rating = MM_MIN_RATING;
+    if (rating > MM_MAX_RATING) rating = MM_MAX_RATING;
+    return (rating - MM_MIN_RATING) / MM_BUCKET_WIDTH;
+}
+
+#define WHEEL_NS ((uint64_t)MM_WHEEL_MS * 1000000ull)
+
+static int wheel_slot(const struct mm_entry *e) {
+    return (int)(e->enq_ns / WHEEL_NS % MM_WHEEL_SLOTS);
+}
+
+static int bucket_nonempty(const struct mm_queue *q, int b) {
+    return (q->nonempty[b >> 6] >> (b & 63)) & 1;
+}
+
+static void record_wait(struct mm_queue *q, const struct mm_entry *e, uint64_t now_ns) {
+    uint64_t us = (now_ns - e->enq_ns) / 1000;
+    int k = us ? 64 - __builtin_clzll(us) : 0;
+    if (k >= MM_HIST_BUCKETS) k = MM_HIST_BUCKETS - 1;
+    q->wait_hist[k]++;
+    q->wait_sum_us += us;
+}
+
+void mm_remove(struct mm_queue *q, struct mm_entry *e) {
+    int b = e->bucket;
+
+    if (e->prev) e->prev->next = e->next; else q->head[b] = e->next;
+    if (e->next) e->next->prev = e->prev; else q->tail[b] = e->prev;
+    if (!q->head[b]) q->nonempty[b >> 6] &= ~(1ull << (b & 63));
+
+    int w = wheel_slot(e);
+    if (e->wprev) e->wprev->wnext = e->wnext; else q->wheel_head[w] = e->wnext;
+    if (e->wnext) e->wnext->wprev = e->wprev; else q->wheel_tail[w] = e->wprev;
+
+    e->prev = e->next = e->wprev = e->wnext = NULL;
+    q->waiting--;
+}
+
+// Best waiting opponent for e within e's window, or NULL. e itself may be
+// queued; it is skipped.
+static struct mm_entry *search(struct mm_queue *q, struct mm_entry *e) {
+    for (int d = 0; d <= e->window; d++) {
+        int sides[2] = { e->bucket - d, e->bucket + d };
+        for (int s = 0; s < (d ? 2 : 1); s++) {
+            int b = sides[s];
+            if (b < 0 || b >= MM_BUCKETS || !bucket_nonempty(q, b)) continue;
+
+            // Oldest first: it has the widest window in this bucket.
+            struct mm_entry *c = q->head[b];
+            if (c == e) c = c->next;
+            if (c && d <= c->window) return c;
+        }
+    }
+    return NULL;
+}
+
+static void pair_up(struct mm_queue *q, struct mm_entry *a, struct mm_entry *b,
+                    uint64_t now_ns)
+{
+    record_wait(q, a, now_ns);
+    record_wait(q, b, now_ns);
+    q->matched += 2;
+}
+
+struct mm_entry *mm_enqueue(struct mm_queue *q, struct mm_entry *e,
+                            void *owner, int rating, uint64_t now_ns)
+{
+    memset(e, 0, sizeof(*e));
+    e->owner  = owner;
+    e->rating = rating;
+    e->bucket = rating_bucket(rating);
+    e->window = MM_BASE_WINDOW;
+    e->enq_ns = now_ns;
+
+    struct mm_entry *c = search(q, e);
+    if (c) {
+        mm_remove(q, c);
+        pair_up(q, e, c, now_ns);
+        return c;
+    }
+
+    int b = e->bucket;
+    e->prev = q->tail[b];
+    if (q->tail[b]) q->tail[b]->next = e; else q->head[b] = e;
+    q->tail[b] = e;
+    q->nonempty[b >> 6] |= 1ull << (b & 63);
+
+    int w = wheel_slot(e);
+    e->wprev = q->wheel_tail[w];
+    if (q->wheel_tail[w]) q->wheel_tail[w]->wnext = e; else q->wheel_head[w] = e;
+    q->wheel_tail[w] = e;
+    q->waiting++;
+    return NULL;
+}
+
+void mm_tick(struct mm_queue *q, uint64_t now_ns,
+             void (*matched)(struct mm_entry *, struct mm_entry *, void *),
+             void *arg)
+{
+    // Steps before now's are over, so everyone due in one is in its slot.
+    // After a long gap one turn of the wheel covers everybody.
+    uint64_t now_step = now_ns / WHEEL_NS;
+    if (q->wheel_step + MM_WHEEL_SLOTS < now_step) q->wheel_step = now_step - MM_WHEEL_SLOTS;
+
+    for (; q->wheel_step < now_step; q->wheel_step++) {
+        struct mm_entry *e = q->wheel_head[q->wheel_step % MM_WHEEL_SLOTS];
+        // Players queued in this very step are at the tail and not due yet.
+        while (e && e->enq_ns / WHEEL_NS < q->wheel_step) {
+            struct mm_entry *next = e->wnext;
+
+            int window = MM_BASE_WINDOW +
+                         (int)((now_ns - e->enq_ns) / (MM_WIDEN_MS * 1000000ull));
+            if (window > MM_BUCKETS) window = MM_BUCKETS;
+            if (window > e->window) {
+                e->window = window;
+                struct mm_entry *c = search(q, e);
+                if (c) {
+                    // next may be c; step past both before unlinking.
+                    while (next && (next == c || next == e)) next = next->wnext;
+                    mm_remove(q, e);
+                    mm_remove(q, c);
+                    pair_up(q, e, c, now_ns);
+                    matched(e, c, arg);
+                }
+            }
+            e = next;
+        }
+    }
+}
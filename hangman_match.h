@@ -0,0 +1,75 @@
+#ifndef HANGMAN_MATCH_H
+#define HANGMAN_MATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Skill-based matchmaking queue for head-to-head races.
+//
+// Waiting players sit in FIFO lists, one per rating bucket, with a bitmap
+// of non-empty buckets. A player's search window starts at
+// MM_BASE_WINDOW buckets either side and widens by one bucket every
+// MM_WIDEN_MS. Two players pair when their bucket distance is within
+// both windows; among those, the nearest bucket, then the longest
+// waiting player, wins. A search touches at most 2 * window buckets and
+// only the head of each, so its cost does not depend on the queue length.
+//
+// Widening runs off a timing wheel of MM_WHEEL_SLOTS slots spanning one
+// MM_WIDEN_MS. A player sits in the slot of the MM_WHEEL_MS step it was
+// queued in; since the wheel turns once per widen period, that slot comes
+// round exactly when the player's window grows again. A tick walks only
+// the slots whose step has passed, so it touches the players due to widen
+// and not the rest of the queue.
+
+#define MM_MIN_RATING    0
+#define MM_MAX_RATING    3999
+#define MM_BUCKET_WIDTH  25
+#define MM_BUCKETS       ((MM_MAX_RATING - MM_MIN_RATING) / MM_BUCKET_WIDTH + 1)
+#define MM_BASE_WINDOW   2
+#define MM_WIDEN_MS      1000
+#define MM_WHEEL_MS      100
+#define MM_WHEEL_SLOTS   (MM_WIDEN_MS / MM_WHEEL_MS)
+#define MM_DEFAULT_RATING 1500
+
+// Match-wait histogram: bucket k counts waits below 2^k microseconds.
+#define MM_HIST_BUCKETS  40
+
+struct mm_entry {
+    void            *owner;
+    int              rating;
+    int              bucket;
+    int              window;        // buckets either side
+    uint64_t         enq_ns;
+    struct mm_entry *prev, *next;   // bucket FIFO
+    struct mm_entry *wprev, *wnext; // wheel slot, oldest first
+};
+
+struct mm_queue {
+    struct mm_entry *head[MM_BUCKETS], *tail[MM_BUCKETS];
+    uint64_t         nonempty[(MM_BUCKETS + 63) / 64];
+    struct mm_entry *wheel_head[MM_WHEEL_SLOTS], *wheel_tail[MM_WHEEL_SLOTS];
+    uint64_t         wheel_step;    // next MM_WHEEL_MS step to widen
+    size_t           waiting;
+    uint64_t         matched;
+    uint64_t         wait_hist[MM_HIST_BUCKETS];
+    uint64_t         wait_sum_us;
+};
+
+void mm_init(struct mm_queue *q);
+
+// Try to pair a new player. Returns the opponent (already removed from
+// the queue), or NULL after queueing e.
+struct mm_entry *mm_enqueue(struct mm_queue *q, struct mm_entry *e,
+                            void *owner, int rating, uint64_t now_ns);
+
+// Drop a waiting player (e.g. it disconnected).
+void mm_remove(struct mm_queue *q, struct mm_entry *e);
+
+// Widen windows that have grown since the last tick and pair whoever now
+// fits, calling matched(a, b, arg) with both already removed. Cheap when
+// no MM_WHEEL_MS step has passed since the last call.
+void mm_tick(struct mm_queue *q, uint64_t now_ns,
+             void (*matched)(struct mm_entry *, struct mm_entry *, void *),
+             void *arg);
+
+#endif
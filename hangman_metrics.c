@@ -0,0 +1,101 @@
+#include "hangman_metrics.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct text {
+    char   *buf;
+    size_t  len, cap;
+};
+
+static void put(struct text *t, const char *fmt, ...) {
+    if (t->len >= t->cap) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) t->len += (size_t)n;
+    if (t->len > t->cap) t->len = t->cap;
+}
+
+static void counter(struct text *t, const char *name, const char *help, uint64_t v) {
+    put(t, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+        name, help, name, name, (unsigned long long)v);
+}
+
+// scale: divisor from recorded units to exported units (ticks per second
+// for latencies).
+static void histogram(struct text *t, const struct stats_segment *seg,
+                      enum stat_hist h, const char *name, const char *help,
+                      double scale) {
+    static uint64_t buckets[HIST_BUCKETS];
+    uint64_t sum = stats_hist_total(seg, h, buckets);
+
+    put(t, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t count = 0;
+    // The last bucket also holds clamped values; it is covered by +Inf.
+    for (int i = 0; i < HIST_BUCKETS - 1; i++) {
+        if (!buckets[i]) continue;
+        count += buckets[i];
+        put(t, "%s_bucket{le=\"%.9g\"} %llu\n", name,
+            (double)stats_hist_upper(i) / scale, (unsigned long long)count);
+    }
+    count += buckets[HIST_BUCKETS - 1];
+    put(t, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+    put(t, "%s_sum %.9g\n%s_count %llu\n", name, (double)sum / scale,
+        name, (unsigned long long)count);
+}
+
+size_t metrics_render(const struct stats_segment *seg, char *out, size_t cap) {
+    struct text t = { .buf = out, .cap = cap };
+    uint64_t c[STAT_COUNT];
+    stats_total(seg, c);
+
+    counter(&t, "hangman_connections_accepted_total",
+            "Connections handed to a game process.", c[STAT_ACCEPTED]);
+    counter(&t, "hangman_connections_rejected_total",
+            "Connections turned away with server-overloaded.", c[STAT_REJECTED]);
+
+    put(&t, "# HELP hangman_active_sessions Live game processes.\n"
+            "# TYPE hangman_active_sessions gauge\nhangman_active_sessions %llu\n",
+        (unsigned long long)__atomic_load_n(&seg->block[0].active, __ATOMIC_RELAXED));
+
+    counter(&t, "hangman_games_started_total", "Solo games started.", c[STAT_GAMES]);
+    put(&t, "# HELP hangman_games_total Solo games finished, by outcome.\n"
+            "# TYPE hangman_games_total counter\n"
+            "hangman_games_total{outcome=\"won\"} %llu\n"
+            "hangman_games_total{outcome=\"lost\"} %llu\n"
+            "hangman_games_total{outcome=\"abandoned\"} %llu\n",
+        (unsigned long long)c[STAT_WON], (unsigned long long)c[STAT_LOST],
+        (unsigned long long)c[STAT_ABANDONED]);
+    counter(&t, "hangman_guesses_total", "Letters guessed in solo games.", c[STAT_GUESSES]);
+    counter(&t, "hangman_hints_total", "Hints served in solo games.", c[STAT_HINTS]);
+
+    double hz = (double)seg->clock_hz;
+    histogram(&t, seg, HIST_GUESS, "hangman_guess_latency_seconds",
+              "Guess received to board or result sent.", hz);
+    histogram(&t, seg, HIST_START, "hangman_start_latency_seconds",
+              "Welcome sent to start frame received.", hz);
+    histogram(&t, seg, HIST_GAME_BYTES, "hangman_game_bytes_sent",
+              "Bytes sent to the player per solo game.", 1);
+    return t.len;
+}
+
+size_t metrics_render_log2(const char *name, const char *help, const uint64_t *buckets,
+                           int n, uint64_t sum, double scale, char *out, size_t cap) {
+    struct text t = { .buf = out, .cap = cap };
+    put(&t, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t count = 0;
+    for (int k = 0; k < n - 1; k++) {
+        if (!buckets[k]) continue;
+        count += buckets[k];
+        put(&t, "%s_bucket{le=\"%.9g\"} %llu\n", name,
+            (double)(1ull << k) / scale, (unsigned long long)count);
+    }
+    count += buckets[n - 1];
+    put(&t, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+    put(&t, "%s_sum %.9g\n%s_count %llu\n", name, (double)sum / scale,
+        name, (unsigned long long)count);
+    return t.len;
+}
@@ -0,0 +1,28 @@
+#ifndef HANGMAN_METRICS_H
+#define HANGMAN_METRICS_H
+
+#include <stddef.h>
+
+#include "hangman_stats.h"
+
+// Prometheus text exposition of the shared stats segment: counters, the
+// active-session gauge and the HDR histograms as cumulative le buckets
+// (only boundaries that hold samples, plus +Inf). Latencies are recorded
+// in stats_clock() ticks and exported in seconds.
+
+// Worst case: every bucket of every histogram non-empty.
+#define METRICS_MAX (4096 + HIST_COUNT * HIST_BUCKETS * 96)
+
+// Render into out (at least METRICS_MAX bytes). Returns the length.
+size_t metrics_render(const struct stats_segment *seg, char *out, size_t cap);
+
+// Worst case for metrics_render_log2 with n buckets.
+#define METRICS_LOG2_MAX(n) (512 + (n) * 96)
+
+// Render one histogram kept outside the segment, where bucket k counts
+// samples below 2^k units and the last bucket holds everything larger
+// (the hub's match waits). scale as for the latencies. Returns the length.
+size_t metrics_render_log2(const char *name, const char *help, const uint64_t *buckets,
+                           int n, uint64_t sum, double scale, char *out, size_t cap);
+
+#endif
@@ -0,0 +1,189 @@
+#include "hangman_proto.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+size_t encode_message(unsigned char *out, const char *msg) {
+    size_t len = strlen(msg);
+    if (len > MSG_MAX) len = MSG_MAX;  // protocol uses 1-byte length
+
+    out[0] = (unsigned char)len;
+    memcpy(out + 1, msg, len);
+    return 1 + len;
+}
+
+size_t encode_game_state(unsigned char *out,
+                         const char *masked,
+                         const unsigned char *incorrect,
+                         unsigned char word_len,
+                         unsigned char num_incorrect)
+{
+    if (word_len == 0 || word_len > MAX_WORD_LEN) return 0;
+    if ((int)word_len + (int)num_incorrect > MAX_WORD_LEN + MAX_WORD_LEN) return 0;
+
+    out[0] = 0;              // msg_flag = 0 => game-control
+    out[1] = word_len;
+    out[2] = num_incorrect;
+    memcpy(out + 3, masked, word_len);
+    memcpy(out + 3 + word_len, incorrect, num_incorrect);
+    return 3 + (size_t)word_len + num_incorrect;
+}
+
+// "The word was l o o k"; out needs 12 + 2 * MAX_WORD_LEN + 1 bytes.
+static size_t format_word(char *out, const char *secret) {
+    static const char prefix[] = "The word was";
+    size_t pos = sizeof(prefix) - 1;
+    memcpy(out, prefix, pos);
+    for (size_t i = 0; i < MAX_WORD_LEN && secret[i]; i++) {
+        out[pos++] = ' ';
+        out[pos++] = secret[i];
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+size_t encode_game_end(unsigned char *out, const char *secret, int won) {
+    char word_msg[3 * MAX_WORD_LEN + 32];
+    format_word(word_msg, secret);
+
+    size_t len = encode_message(out, word_msg);
+    len += encode_message(out + len, won ? "You Win!" : "You Lose.");
+    len += encode_message(out + len, "Game Over!");
+    return len;
+}
+
+// ---------- protocol v2 ----------
+
+size_t varint_put(unsigned char *out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+int varint_get(const unsigned char **p, const unsigned char *end, uint32_t *out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 7 * VARINT_MAX; shift += 7) {
+        if (*p >= end) return -1;
+        unsigned char b = *(*p)++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            if (v > UINT32_MAX) return -1;
+            *out = (uint32_t)v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static size_t v2_header(unsigned char *out, enum v2_type type, size_t len) {
+    out[0] = (unsigned char)type;
+    return 1 + varint_put(out + 1, (uint32_t)len);
+}
+
+size_t v2_encode_text(unsigned char *out, const char *msg, size_t len) {
+    size_t hdr = v2_header(out, V2_TEXT, len);
+    memcpy(out + hdr, msg, len);
+    return hdr + len;
+}
+
+size_t v2_encode_board(unsigned char *out,
+                       const char *masked,
+                       const unsigned char *incorrect,
+                       unsigned char word_len,
+                       unsigned char num_incorrect)
+{
+    if (word_len == 0 || word_len > MAX_WORD_LEN) return 0;
+    if (num_incorrect > MAX_WORD_LEN) return 0;
+
+    size_t hdr = v2_header(out, V2_BOARD, 1 + (size_t)word_len + num_incorrect);
+    out[hdr] = word_len;
+    memcpy(out + hdr + 1, masked, word_len);
+    memcpy(out + hdr + 1 + word_len, incorrect, num_incorrect);
+    return hdr + 1 + (size_t)word_len + num_incorrect;
+}
+
+size_t v2_encode_status(unsigned char *out, enum v2_status code) {
+    unsigned char body[VARINT_MAX];
+    size_t n = varint_put(body, (uint32_t)code);
+    size_t hdr = v2_header(out, V2_STATUS, n);
+    memcpy(out + hdr, body, n);
+    return hdr + n;
+}
+
+size_t v2_encode_reveal(unsigned char *out, unsigned char letter, uint16_t mask) {
+    size_t hdr = v2_header(out, V2_REVEAL, 3);
+    out[hdr]     = letter;
+    out[hdr + 1] = (unsigned char)(mask & 0xff);
+    out[hdr + 2] = (unsigned char)(mask >> 8);
+    return hdr + 3;
+}
+
+size_t v2_encode_miss(unsigned char *out, unsigned char letter) {
+    size_t hdr = v2_header(out, V2_MISS, 1);
+    out[hdr] = letter;
+    return hdr + 1;
+}
+
+size_t v2_encode_hint(unsigned char *out, int letter) {
+    size_t hdr = v2_header(out, V2_HINT, letter > 0 ? 1 : 0);
+    if (letter <= 0) return hdr;
+    out[hdr] = (unsigned char)letter;
+    return hdr + 1;
+}
+
+size_t v2_encode_game_end(unsigned char *out, const char *secret, int won) {
+    size_t n = strnlen(secret, MAX_WORD_LEN);
+    size_t len = v2_header(out, V2_WORD, n);
+    memcpy(out + len, secret, n);
+    len += n;
+    len += v2_encode_status(out + len, won ? V2_ST_WIN : V2_ST_LOSE);
+    len += v2_encode_status(out + len, V2_ST_GAME_OVER);
+    return len;
+}
+
+int start_for_hub(const char *cmd, size_t len) {
+    if (len == 0) return 0;
+    switch (cmd[0]) {
+    case START_JOIN_ROOM:
+    case START_MATCH:
+    case START_TOURNEY:
+    case START_RANK:
+    case START_STATS:
+    case START_WATCH:
+        return 1;
+    }
+    return 0;
+}
+
+int replay_differs(const char *cmd, int words, int evil) {
+    char *end;
+    (void)strtol(cmd + 1, &end, 10);
+    if (*end != ',') return 0;
+    if (strtol(end + 1, &end, 10) != words || *end != ',') return 1;
+    return strtol(end + 1, NULL, 10) != evil;
+}
+
+int replay_resumed(const char *cmd, uint32_t *guessed, unsigned char *misses, size_t max) {
+    *guessed = 0;
+    const char *p = cmd;
+    for (int field = 0; field < 3; field++) {
+        p = strchr(p, ',');
+        if (!p) return 0;
+        p++;
+    }
+    char *end;
+    unsigned long mask = strtoul(p, &end, 16);
+    if (end == p || *end != ',' || mask == 0 || mask >= 1ul << 26) return -1;
+    size_t n = 0;
+    for (p = end + 1; *p; p++) {
+        int c = (unsigned char)*p - 'a';
+        if (c < 0 || c >= 26 || !((mask >> c) & 1) || n == max) return -1;
+        misses[n++] = (unsigned char)*p;
+    }
+    *guessed = (uint32_t)mask;
+    return (int)n;
+}
@@ -0,0 +1,142 @@
+#ifndef HANGMAN_PROTO_H
+#define HANGMAN_PROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_dict.h"
+
+// Wire format (server -> client):
+//   message:       [msg_flag = len > 0][len bytes of text]
+//   game-control:  [0][word_len][num_incorrect][masked][incorrect]
+// Client -> server frames are [len][payload]: the start frame (len 0, or a
+// start command below), guesses (len 1), hint requests (len 0 mid-game).
+
+#define MSG_MAX          255
+#define MESSAGE_PKT_MAX  (1 + MSG_MAX)
+#define GAME_STATE_MAX   (3 + MAX_WORD_LEN + MAX_WORD_LEN)
+
+// Start-frame commands (first payload byte of a non-empty start frame).
+#define START_JOIN_ROOM  'R'    // "R<decimal room id>": play in a shared room
+#define START_WATCH      'S'    // "SR<id>" / "SS<id>": spectate a room / session
+#define START_MATCH      'M'    // "M<rating>": queue for a head-to-head race
+#define START_STATS      'Q'    // "Q": hub statistics as text messages
+#define START_TOURNEY    'T'    // "T<id>": play in a timed tournament
+#define START_PLAYER     'P'    // "P<name>": solo game recorded on the leaderboard
+#define START_RANK       'L'    // "L<name>": leaderboard rank as text messages
+#define START_REPLAY     'W'    // "W<word index>[,<words>,<evil>[,<guessed>,<misses>]]": solo game on that word (--replay servers only)
+#define START_RESUME     'K'    // "K": resumable solo game, "K<hex token>": carry one on (--resume servers)
+#define START_V2         'V'    // "V<features><command>": v2 framing, see below
+
+// Sent, then Game Over, for a START_REPLAY naming a dictionary size or
+// evil mode other than the server's: the trace cannot match.
+#define REPLAY_CONFIG_DIFFERS "server configuration differs"
+
+// Whether a START_REPLAY command ("W<index>,<words>,<evil>") names a
+// configuration other than words/evil. A bare "W<index>" names none.
+int replay_differs(const char *cmd, int words, int evil);
+
+// The state a START_REPLAY command picks the game up from, for a trace of
+// a resumed game: "...,<guessed letters, hex bitmask>,<misses in order>".
+// Fills *guessed (0 if the command has none) and up to max misses.
+// Returns the number of misses, or -1 if the state is malformed.
+int replay_resumed(const char *cmd, uint32_t *guessed, unsigned char *misses, size_t max);
+
+// Sent in v2, then the GAME_OVER status, to a v2 client whose start
+// command goes to the room hub: the hub speaks only v1.
+#define V2_SOLO_ONLY "protocol v2 is for solo games"
+
+// Whether a start command (after any 'V' prefix) is one the room hub
+// serves: rooms, races, tournaments, rank, stats and spectating.
+int start_for_hub(const char *cmd, size_t len);
+
+// Encode a message packet into out (at least MESSAGE_PKT_MAX bytes).
+// Messages longer than MSG_MAX are truncated. Returns the packet length.
+size_t encode_message(unsigned char *out, const char *msg);
+
+// Encode a game-control packet into out (at least GAME_STATE_MAX bytes).
+// Returns the packet length, or 0 if the board does not fit.
+size_t encode_game_state(unsigned char *out,
+                         const char *masked,
+                         const unsigned char *incorrect,
+                         unsigned char word_len,
+                         unsigned char num_incorrect);
+
+// Encode the three end-of-game messages ("The word was l o o k",
+// "You Win!"/"You Lose.", "Game Over!") back to back into out (at least
+// GAME_END_MAX bytes). Returns the total length.
+#define GAME_END_MAX (3 * MESSAGE_PKT_MAX)
+size_t encode_game_end(unsigned char *out, const char *secret, int won);
+
+// ---------- protocol v2 ----------
+//
+// A client opts in with the start frame: 'V', one features byte (V2_F_*
+// bits, 0 for none), then any solo start command ("", "P<name>",
+// "W<index>"). Every server frame after that is
+//   [type][varint payload length][payload]
+// so a reader can skip types it does not know, and text is not limited
+// to 255 bytes. Varints are LEB128: 7 bits per byte, low bits first.
+// Client -> server frames stay [len][payload]; a guess is already two
+// bytes. The welcome (or server-overloaded) precedes the start frame and
+// so is always v1.
+
+// Features byte bits.
+#define V2_F_DELTA  0x01    // after the first board, send V2_REVEAL / V2_MISS
+
+enum v2_type {
+    V2_TEXT   = 1,      // text
+    V2_BOARD  = 2,      // [word_len][masked][incorrect]; the rest of the
+                        // payload after masked is the incorrect list
+    V2_STATUS = 3,      // [varint code]: V2_ST_*
+    V2_REVEAL = 4,      // [letter][mask lo][mask hi]: letter now shows at
+                        // each set bit (bit i = position i); 0 = no change
+    V2_MISS   = 5,      // [letter]: appended to the incorrect list
+    V2_WORD   = 6,      // the secret word, raw letters (end of game)
+    V2_HINT   = 7,      // [letter], or empty for "no hint left"
+};
+
+enum v2_status {
+    V2_ST_WIN       = 1,
+    V2_ST_LOSE      = 2,
+    V2_ST_GAME_OVER = 3,    // last frame of the game; the server closes next
+};
+
+#define VARINT_MAX      5                                   // a uint32_t
+#define V2_HDR_MAX      (1 + VARINT_MAX)
+#define V2_TEXT_MAX     (V2_HDR_MAX + MSG_MAX)              // the server's own texts
+#define V2_BOARD_MAX    (V2_HDR_MAX + 1 + MAX_WORD_LEN + MAX_WORD_LEN)
+#define V2_STATUS_MAX   (V2_HDR_MAX + VARINT_MAX)
+#define V2_DELTA_MAX    (V2_HDR_MAX + 3)
+#define V2_HINT_MAX     (V2_HDR_MAX + 1)
+#define V2_GAME_END_MAX (V2_HDR_MAX + MAX_WORD_LEN + 2 * V2_STATUS_MAX)
+
+// Write v as a varint; returns the bytes used (at most VARINT_MAX).
+size_t varint_put(unsigned char *out, uint32_t v);
+
+// Read a varint from [*p, end) and advance *p. 0 on success, -1 if it is
+// truncated or does not fit in 32 bits.
+int varint_get(const unsigned char **p, const unsigned char *end, uint32_t *out);
+
+// v2 encoders; each returns the frame length (0 if it does not fit).
+// v2_encode_text needs V2_HDR_MAX + len bytes of out; len is not capped.
+size_t v2_encode_text(unsigned char *out, const char *msg, size_t len);
+size_t v2_encode_board(unsigned char *out,
+                       const char *masked,
+                       const unsigned char *incorrect,
+                       unsigned char word_len,
+                       unsigned char num_incorrect);
+size_t v2_encode_status(unsigned char *out, enum v2_status code);
+
+// Delta boards (V2_F_DELTA): what one guess changed. The client keeps the
+// board from the last V2_BOARD and applies these to it.
+size_t v2_encode_reveal(unsigned char *out, unsigned char letter, uint16_t mask);
+size_t v2_encode_miss(unsigned char *out, unsigned char letter);
+
+// Hint reply: letter 'a'..'z', or 0 for none.
+size_t v2_encode_hint(unsigned char *out, int letter);
+
+// v2 counterpart of encode_game_end: V2_WORD, then WIN or LOSE, then
+// GAME_OVER. The client does the formatting.
+size_t v2_encode_game_end(unsigned char *out, const char *secret, int won);
+
+#endif
@@ -0,0 +1,740 @@
+#define _GNU_SOURCE     // splice, accept4, pipe2
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_proto.h"
+#include "hangman_room.h"
+
+// One public port in front of many hangman_server processes:
+//
+//   hangman_proxy <port> <backend>...
+//
+// A backend is "ip:port", or a Unix socket path (a server started with
+// --unix) if it starts with '/', optionally followed by "@" and the
+// address of its --metrics listener in the same form.
+//
+// The proxy answers the welcome itself and reads the start frame, since
+// that is what decides where a player belongs. Commands that name shared
+// state go to the backend that owns it, by rendezvous hash of the key, so
+// everyone in room 7 meets on one server and losing a backend only moves
+// its own keys:
+//
+//   R<id>, SR<id>   the room
+//   T<id>           the tournament
+//   M...            matchmaking (one pool)
+//   P<name>, L<name> the player's leaderboard entry
+//
+// Everything else (solo games, replays, Q, SS) goes to the healthy backend
+// with the fewest connections through the proxy. The proxy connects,
+// swallows the backend's welcome, passes the start frame on, and from
+// then on only moves bytes with splice() through a pipe per direction;
+// game traffic never enters user space. A backend that answers
+// server-overloaded is skipped for the next one (solo games only; a
+// shared key has one home), and one that refuses the connection is
+// marked down.
+//
+// Every PROXY_CHECK_MS each backend with a metrics address is probed
+// there: it is up if the scrape starts "HTTP/1.0 200" before the next
+// probe. The server's hub answers scrapes, so a probe never costs a game
+// connection (a forked child on a fork-mode server). A backend without
+// one is judged by the player connections alone: a refused connect marks
+// it down, a welcome marks it up. A server drained with SIGTERM closes
+// its listeners first, metrics included, so the proxy stops sending it
+// players while its games run out. SIGTERM to the proxy drains the proxy
+// the same way; SIGUSR1 prints per-backend counts.
+
+#define PROXY_MAX_BACKENDS  64
+#define PROXY_MAX_CONNS     1024
+#define PROXY_PIPE_CAP      65536   // bytes parked per direction
+#define PROXY_CHECK_MS      1000
+#define PROXY_CONNECT_MS    2000    // backend connect + welcome
+#define PROXY_START_MS      10000   // client's start frame after our welcome
+#define PROXY_TICK_MS       100
+#define PROXY_EVENTS        256
+#define BACKLOG             128
+
+// epoll tags: a connection side is (conn index << 1) | side.
+#define TAG_LISTEN  UINT64_MAX
+#define TAG_PROBE   (1ull << 62)
+
+enum { SIDE_CLIENT = 0, SIDE_BACKEND = 1 };
+
+struct backend {
+    char                    spec[108];
+    struct sockaddr_storage addr;
+    socklen_t               addr_len;
+    uint64_t                id_hash;
+    int                     up;         // last probe or connect got through
+    int                     active;     // connections routed here now
+    uint64_t                total;
+    struct sockaddr_storage health;     // --metrics listener
+    socklen_t               health_len; // 0 = none, no probes
+    int                     probe_fd;   // probe in flight, or -1
+    char                    probe_buf[16];
+    size_t                  probe_have;
+};
+
+enum conn_state {
+    C_FREE,
+    C_START,        // welcome sent, reading the client's start frame
+    C_WELCOME,      // backend connecting, reading its welcome
+    C_SPLICE,       // forwarding both ways
+};
+
+// One direction, named after the side it reads from.
+struct pump {
+    int    pipe[2];         // kept with the slot while empty
+    size_t queued;          // bytes in the pipe
+    int    eof, shut;
+};
+
+struct conn {
+    enum conn_state state;
+    int             fd[2];
+    uint32_t        events[2];      // current epoll interest, 0 = not added
+    int             backend;
+    uint64_t        tried;          // backends already attempted, by bit
+    int             keyed, v2;
+    uint64_t        key;
+    uint64_t        deadline_ms;
+    unsigned char   start[1 + MSG_MAX];
+    size_t          start_have;
+    unsigned char   reply[1 + MSG_MAX];
+    size_t          reply_have;
+    struct pump     dir[2];
+};
+
+static struct backend backends[PROXY_MAX_BACKENDS];
+static int            n_backends;
+static struct conn    conns[PROXY_MAX_CONNS];
+static int            free_conns[PROXY_MAX_CONNS];
+static int            n_free;
+static int            epfd, lsock = -1;
+static unsigned int   rr;           // rotates least-connections ties
+
+static volatile sig_atomic_t draining = 0, want_status = 0;
+
+static const char overloaded[] = "server-overloaded";
+static const char health_ok[]  = "HTTP/1.0 200";
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static uint64_t fnv1a(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return x;
+}
+
+static void on_signal(int sig) {
+    if (sig == SIGUSR1) want_status = 1;
+    else draining = 1;
+}
+
+// ---------- backends ----------
+
+// "ip:port" or a Unix socket path into addr. Returns the address length,
+// or 0 if spec is not one.
+static socklen_t parse_addr(struct sockaddr_storage *addr, const char *spec) {
+    if (spec[0] == '/') {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        if (strlen(spec) >= sizeof(un->sun_path)) return 0;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, spec);
+        return sizeof(*un);
+    }
+    const char *colon = strrchr(spec, ':');
+    if (!colon || colon == spec) return 0;
+    char host[64];
+    size_t hl = (size_t)(colon - spec);
+    if (hl >= sizeof(host)) return 0;
+    memcpy(host, spec, hl);
+    host[hl] = '\0';
+    struct sockaddr_in *in = (struct sockaddr_in *)addr;
+    in->sin_family = AF_INET;
+    in->sin_port   = htons(atoi(colon + 1));
+    if (inet_pton(AF_INET, host, &in->sin_addr) != 1 || in->sin_port == 0) return 0;
+    return sizeof(*in);
+}
+
+static int parse_backend(struct backend *b, const char *spec) {
+    memset(b, 0, sizeof(*b));
+    if (strlen(spec) >= sizeof(b->spec)) return -1;
+    strcpy(b->spec, spec);
+    b->probe_fd = -1;
+    b->up       = 1;    // until a probe or a connect says otherwise
+
+    char *at = strchr(b->spec, '@');
+    if (at) {
+        *at = '\0';
+        b->health_len = parse_addr(&b->health, at + 1);
+        if (b->health_len == 0) return -1;
+    }
+    // Keys follow the game address alone.
+    b->id_hash  = fnv1a(b->spec, strlen(b->spec));
+    b->addr_len = parse_addr(&b->addr, b->spec);
+    if (at) *at = '@';
+    return b->addr_len > 0 ? 0 : -1;
+}
+
+static void set_up(struct backend *b, int up) {
+    if (b->up == up) return;
+    b->up = up;
+    printf("Backend %s %s\n", b->spec, up ? "up" : "down");
+    fflush(stdout);
+}
+
+// Non-blocking connect. Returns the fd (connect possibly in progress), or
+// -1 with errno set.
+static int connect_to(const struct sockaddr_storage *addr, socklen_t len) {
+    int fd = socket(addr->ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (const struct sockaddr *)addr, len) < 0 && errno != EINPROGRESS) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    if (addr->ss_family == AF_INET) {
+        int one = 1;
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static int backend_connect(const struct backend *b) {
+    return connect_to(&b->addr, b->addr_len);
+}
+
+// Probe every backend that has a metrics address; a probe still
+// unanswered from last time means down.
+static void run_probes(void) {
+    for (int i = 0; i < n_backends; i++) {
+        struct backend *b = &backends[i];
+        if (b->health_len == 0) continue;
+        if (b->probe_fd >= 0) {
+            close(b->probe_fd);
+            b->probe_fd = -1;
+            set_up(b, 0);
+        }
+        int fd = connect_to(&b->health, b->health_len);
+        if (fd < 0) {
+            set_up(b, 0);
+            continue;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = TAG_PROBE | (uint64_t)i };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        b->probe_fd   = fd;
+        b->probe_have = 0;
+    }
+}
+
+// The hub answers a scrape as soon as it accepts, request or not; the
+// status line is all the probe reads.
+static void probe_event(int i) {
+    struct backend *b = &backends[i];
+    size_t want = sizeof(health_ok) - 1;
+    while (b->probe_have < want) {
+        ssize_t n = recv(b->probe_fd, b->probe_buf + b->probe_have, want - b->probe_have,
+                         MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) break;
+        b->probe_have += (size_t)n;
+    }
+    close(b->probe_fd);
+    b->probe_fd = -1;
+    set_up(b, b->probe_have == want && memcmp(b->probe_buf, health_ok, want) == 0);
+}
+
+static void print_status(void) {
+    for (int i = 0; i < n_backends; i++) {
+        const struct backend *b = &backends[i];
+        printf("backend %-24s %-4s %5d active %10llu total\n", b->spec,
+               b->up ? "up" : "down", b->active, (unsigned long long)b->total);
+    }
+    printf("%d connections%s\n", PROXY_MAX_CONNS - n_free, draining ? ", draining" : "");
+    fflush(stdout);
+}
+
+// Best untried backend: up before down, then the highest rendezvous
+// score for a keyed start, or the fewest connections otherwise.
+static int pick_backend(const struct conn *c) {
+    int best = -1, best_up = 0;
+    uint64_t best_score = 0;
+    for (int k = 0; k < n_backends; k++) {
+        int i = (int)((rr + (unsigned int)k) % (unsigned int)n_backends);
+        if (c->tried & (1ull << i)) continue;
+        const struct backend *b = &backends[i];
+        uint64_t score = c->keyed ? mix64(c->key ^ b->id_hash) : UINT64_MAX - (uint64_t)b->active;
+        if (best < 0 || b->up > best_up || (b->up == best_up && score > best_score)) {
+            best       = i;
+            best_up    = b->up;
+            best_score = score;
+        }
+    }
+    rr++;
+    return best;
+}
+
+// ---------- connections ----------
+
+static void watch(struct conn *c, int side, uint32_t events) {
+    if (c->events[side] == events) return;
+    struct epoll_event ev = {
+        .events = events, .data.u64 = ((uint64_t)(c - conns) << 1) | (uint64_t)side,
+    };
+    // Nothing wanted: leave the set, or a hung-up peer would keep waking us.
+    int op = events == 0 ? EPOLL_CTL_DEL : c->events[side] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epfd, op, c->fd[side], &ev) == 0) c->events[side] = events;
+}
+
+static void drop_backend(struct conn *c) {
+    if (c->fd[SIDE_BACKEND] < 0) return;
+    close(c->fd[SIDE_BACKEND]);     // also leaves the epoll set
+    c->fd[SIDE_BACKEND]     = -1;
+    c->events[SIDE_BACKEND] = 0;
+    backends[c->backend].active--;
+    c->backend = -1;
+}
+
+static void close_conn(struct conn *c) {
+    drop_backend(c);
+    close(c->fd[SIDE_CLIENT]);
+    for (int d = 0; d < 2; d++) {
+        // An empty pipe is reused by the slot's next connection.
+        if (c->dir[d].queued > 0 && c->dir[d].pipe[0] >= 0) {
+            close(c->dir[d].pipe[0]);
+            close(c->dir[d].pipe[1]);
+            c->dir[d].pipe[0] = c->dir[d].pipe[1] = -1;
+        }
+    }
+    c->state = C_FREE;
+    free_conns[n_free++] = (int)(c - conns);
+}
+
+// Turn the client away after its start frame: the proxy already sent the
+// welcome, so say it in the framing the client asked for.
+static void refuse(struct conn *c) {
+    unsigned char out[MESSAGE_PKT_MAX + V2_TEXT_MAX + V2_STATUS_MAX];
+    size_t n;
+    if (c->v2) {
+        n  = v2_encode_text(out, overloaded, sizeof(overloaded) - 1);
+        n += v2_encode_status(out + n, V2_ST_GAME_OVER);
+    } else {
+        n  = encode_message(out, overloaded);
+        n += encode_message(out + n, "Game Over!");
+    }
+    (void)send(c->fd[SIDE_CLIENT], out, n, MSG_NOSIGNAL | MSG_DONTWAIT);
+    close_conn(c);
+}
+
+// Connect to the next candidate backend; refuses the client if none is left.
+static void connect_backend(struct conn *c) {
+    for (;;) {
+        int i = pick_backend(c);
+        if (i < 0) {
+            refuse(c);
+            return;
+        }
+        c->tried |= 1ull << i;
+        struct backend *b = &backends[i];
+        int fd = backend_connect(b);
+        if (fd < 0) {
+            if (errno != EAGAIN) set_up(b, 0);     // EAGAIN: Unix backlog full
+            continue;
+        }
+        c->fd[SIDE_BACKEND] = fd;
+        c->backend          = i;
+        c->reply_have       = 0;
+        c->deadline_ms      = now_ms() + PROXY_CONNECT_MS;
+        c->state            = C_WELCOME;
+        b->active++;
+        b->total++;
+        // A failed connect shows up as EPOLLERR, which recv reports.
+        watch(c, SIDE_BACKEND, EPOLLIN);
+        return;
+    }
+}
+
+// The backend fell through before forwarding began: down marks it
+// unreachable. A solo game tries the next backend; a keyed one has only
+// one home, unless that home is down.
+static void backend_failed(struct conn *c, int down) {
+    struct backend *b = &backends[c->backend];
+    drop_backend(c);
+    if (down) set_up(b, 0);
+    if (c->keyed && !down) {
+        refuse(c);
+        return;
+    }
+    connect_backend(c);
+}
+
+// Read one [len][payload] frame without reading past it. 1 when
+// complete, 0 for more to come, -1 on EOF or error.
+static int read_frame(int fd, unsigned char *buf, size_t *have) {
+    for (;;) {
+        size_t want = *have == 0 ? 1 : 1 + (size_t)buf[0];
+        if (*have >= want) return 1;
+        ssize_t n = recv(fd, buf + *have, want - *have, 0);
+        if (n > 0) {
+            *have += (size_t)n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+}
+
+// Routing key of a start frame; sets c->keyed, c->key and c->v2.
+static void start_key(struct conn *c) {
+    const unsigned char *cmd = c->start + 1;
+    size_t len = c->start[0];
+    if (len > 0 && cmd[0] == START_V2) {
+        c->v2 = 1;
+        size_t skip = len > 1 ? 2 : 1;      // 'V' and the features byte
+        cmd += skip;
+        len -= skip;
+    }
+    char key[1 + MSG_MAX];
+    size_t klen = 0;
+    if (len > 0) {
+        switch (cmd[0]) {
+        case START_JOIN_ROOM:
+        case START_TOURNEY:
+        case START_PLAYER:
+            memcpy(key, cmd, len);
+            klen = len;
+            break;
+        case START_RANK:        // same key as the P<name> games it ranks
+            key[0] = START_PLAYER;
+            memcpy(key + 1, cmd + 1, len - 1);
+            klen = len;
+            break;
+        case START_MATCH:
+            key[0] = START_MATCH;
+            klen = 1;
+            break;
+        case START_WATCH:       // SR<id> watches room <id>
+            if (len > 1 && cmd[1] == FEED_ROOM) {
+                key[0] = START_JOIN_ROOM;
+                memcpy(key + 1, cmd + 2, len - 2);
+                klen = len - 1;
+            }
+            break;
+        }
+    }
+    c->keyed = klen > 0;
+    c->key   = klen > 0 ? fnv1a(key, klen) : 0;
+}
+
+static void accept_clients(void) {
+    static unsigned char welcome[MESSAGE_PKT_MAX];
+    static size_t welcome_len;
+    if (!welcome_len) welcome_len = encode_message(welcome, "Welcome to Hangman");
+
+    for (;;) {
+        int fd = accept4(lsock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) perror("accept");
+            return;
+        }
+        int one = 1;
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        int any_up = 0;
+        for (int i = 0; i < n_backends; i++) any_up |= backends[i].up;
+        if (n_free == 0 || !any_up) {
+            unsigned char busy[MESSAGE_PKT_MAX];
+            (void)send(fd, busy, encode_message(busy, overloaded), MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(fd);
+            continue;
+        }
+        if (send(fd, welcome, welcome_len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)welcome_len) {
+            close(fd);
+            continue;
+        }
+
+        struct conn *c = &conns[free_conns[--n_free]];
+        c->state       = C_START;
+        c->fd[0]       = fd;
+        c->fd[1]       = -1;
+        c->events[0]   = c->events[1] = 0;
+        c->backend     = -1;
+        c->tried       = 0;
+        c->keyed       = c->v2 = 0;
+        c->start_have  = 0;
+        c->deadline_ms = now_ms() + PROXY_START_MS;
+        for (int d = 0; d < 2; d++) {
+            c->dir[d].queued = 0;
+            c->dir[d].eof    = c->dir[d].shut = 0;
+        }
+        watch(c, SIDE_CLIENT, EPOLLIN);
+    }
+}
+
+// ---------- forwarding ----------
+
+// Move whatever is ready in direction d: socket -> pipe -> socket, no
+// copies through user space. -1 if the connection broke.
+static int pump(struct conn *c, int d) {
+    struct pump *p = &c->dir[d];
+    int src = c->fd[d], dst = c->fd[1 - d];
+    for (;;) {
+        ssize_t in = 0, out = 0;
+        if (!p->eof && p->queued < PROXY_PIPE_CAP) {
+            in = splice(src, NULL, p->pipe[1], NULL, PROXY_PIPE_CAP - p->queued,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (in == 0) {
+                p->eof = 1;
+            } else if (in < 0) {
+                if (errno != EAGAIN) return -1;
+                in = 0;
+            } else {
+                p->queued += (size_t)in;
+            }
+        }
+        if (p->queued > 0) {
+            out = splice(p->pipe[0], NULL, dst, NULL, p->queued,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (out < 0) {
+                if (errno != EAGAIN) return -1;
+                out = 0;
+            } else {
+                p->queued -= (size_t)out;
+            }
+        }
+        if (in == 0 && out == 0) break;
+    }
+    if (p->eof && p->queued == 0 && !p->shut) {
+        (void)shutdown(dst, SHUT_WR);   // pass the half-close along
+        p->shut = 1;
+    }
+    return 0;
+}
+
+// Each side reads while its pipe has room and writes while the other
+// side's pipe holds bytes.
+static void update_interest(struct conn *c) {
+    for (int s = 0; s < 2; s++) {
+        uint32_t ev = 0;
+        if (!c->dir[s].eof && c->dir[s].queued < PROXY_PIPE_CAP) ev |= EPOLLIN;
+        if (c->dir[1 - s].queued > 0) ev |= EPOLLOUT;
+        watch(c, s, ev);
+    }
+}
+
+static void start_splicing(struct conn *c) {
+    for (int d = 0; d < 2; d++) {
+        if (c->dir[d].pipe[0] < 0 && pipe2(c->dir[d].pipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+            perror("pipe2");
+            close_conn(c);
+            return;
+        }
+    }
+    c->state       = C_SPLICE;
+    c->deadline_ms = 0;
+    update_interest(c);
+}
+
+static void conn_event(struct conn *c, int side) {
+    switch (c->state) {
+    case C_START: {
+        int r = read_frame(c->fd[SIDE_CLIENT], c->start, &c->start_have);
+        if (r < 0) {
+            close_conn(c);
+        } else if (r > 0) {
+            watch(c, SIDE_CLIENT, 0);   // nothing more until the backend is ready
+            start_key(c);
+            connect_backend(c);
+        }
+        return;
+    }
+    case C_WELCOME: {
+        int r = read_frame(c->fd[SIDE_BACKEND], c->reply, &c->reply_have);
+        if (r < 0) {
+            backend_failed(c, 1);
+        } else if (r > 0) {
+            // Any answer shows the backend is there.
+            set_up(&backends[c->backend], 1);
+            if (c->reply[0] == sizeof(overloaded) - 1 &&
+                memcmp(c->reply + 1, overloaded, sizeof(overloaded) - 1) == 0) {
+                backend_failed(c, 0);
+                return;
+            }
+            // Our welcome went out already; the backend's is dropped.
+            size_t n = 1 + (size_t)c->start[0];
+            if (send(c->fd[SIDE_BACKEND], c->start, n, MSG_NOSIGNAL) != (ssize_t)n) {
+                backend_failed(c, 1);
+                return;
+            }
+            start_splicing(c);
+        }
+        return;
+    }
+    case C_SPLICE:
+        if (pump(c, side) < 0 || pump(c, 1 - side) < 0) {
+            close_conn(c);
+            return;
+        }
+        if (c->dir[0].shut && c->dir[1].shut) {
+            close_conn(c);
+            return;
+        }
+        update_interest(c);
+        return;
+    case C_FREE:
+        return;
+    }
+}
+
+// A client that never sends its start frame would hold a slot for good;
+// a backend that never welcomes counts as down.
+static void expire_connects(uint64_t now) {
+    for (int i = 0; i < PROXY_MAX_CONNS; i++) {
+        struct conn *c = &conns[i];
+        if (c->state == C_START && c->deadline_ms <= now) close_conn(c);
+        else if (c->state == C_WELCOME && c->deadline_ms <= now) backend_failed(c, 1);
+    }
+}
+
+// ---------- main ----------
+
+static int open_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int yes = 1;
+    (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc - 2 > PROXY_MAX_BACKENDS) {
+        fprintf(stderr, "Usage: %s <port> <ip:port|unix_path>[@<metrics>]... (at most %d backends)\n",
+                argv[0], PROXY_MAX_BACKENDS);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (parse_backend(&backends[n_backends++], argv[i]) < 0) {
+            fprintf(stderr, "bad backend: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Six descriptors per connection: two sockets, two pipes.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);       // splice into a closed socket
+
+    epfd  = epoll_create1(EPOLL_CLOEXEC);
+    lsock = open_listener(atoi(argv[1]));
+    if (epfd < 0 || lsock < 0) {
+        perror("listen");
+        return 1;
+    }
+    struct epoll_event lev = { .events = EPOLLIN, .data.u64 = TAG_LISTEN };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, lsock, &lev);
+
+    for (int i = PROXY_MAX_CONNS - 1; i >= 0; i--) {
+        conns[i].dir[0].pipe[0] = conns[i].dir[0].pipe[1] = -1;
+        conns[i].dir[1].pipe[0] = conns[i].dir[1].pipe[1] = -1;
+        free_conns[n_free++] = i;
+    }
+
+    printf("Hangman proxy on port %s, %d backends\n", argv[1], n_backends);
+    fflush(stdout);
+    run_probes();
+    uint64_t next_probe = now_ms() + PROXY_CHECK_MS;
+
+    static struct epoll_event events[PROXY_EVENTS];
+    for (;;) {
+        if (draining && lsock >= 0) {
+            close(lsock);
+            lsock = -1;
+            printf("Draining %d connections\n", PROXY_MAX_CONNS - n_free);
+            fflush(stdout);
+        }
+        if (draining && n_free == PROXY_MAX_CONNS) break;
+        if (want_status) {
+            want_status = 0;
+            print_status();
+        }
+
+        int n = epoll_wait(epfd, events, PROXY_EVENTS, PROXY_TICK_MS);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == TAG_LISTEN) {
+                if (lsock >= 0) accept_clients();
+            } else if (tag & TAG_PROBE) {
+                int b = (int)(tag & ~TAG_PROBE);
+                if (backends[b].probe_fd >= 0) probe_event(b);
+            } else {
+                struct conn *c = &conns[tag >> 1];
+                int side = (int)(tag & 1);
+                // Skip stale events for a side closed earlier in this batch.
+                if (c->state != C_FREE && c->fd[side] >= 0) conn_event(c, side);
+            }
+        }
+
+        uint64_t now = now_ms();
+        expire_connects(now);
+        if (now >= next_probe) {
+            run_probes();
+            next_probe = now + PROXY_CHECK_MS;
+        }
+    }
+    return 0;
+}
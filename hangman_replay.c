@@ -0,0 +1,286 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hangman_capture.h"
+#include "hangman_proto.h"
+#include "hangman_stats.h"
+
+// Replays captured solo games (hangman_capture.<session>.bin) against a
+// server started with --replay. The recorded start frame is replaced by
+// START_REPLAY with the recorded word, dictionary size and evil mode (the
+// server refuses a trace from another configuration) and, for a game
+// resumed with its token, the state it picked up from. Every other client
+// frame is sent as captured, and everything the server sends back is
+// compared byte for byte with the captured server frames.
+//
+//   hangman_replay <ip> <port> <1|10|max> <capture>...
+//
+// Speed 1 keeps the recorded gaps before each client frame, 10 divides
+// them by ten, max sends as soon as the expected reply has arrived.
+
+#define REPLAY_TIMEOUT_SEC   5
+#define REPLAY_BUSY_RETRIES  100
+
+static const char overloaded[] = "\x11server-overloaded";
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = { .tv_sec = (time_t)(ns / 1000000000ull),
+                           .tv_nsec = (long)(ns % 1000000000ull) };
+    while (nanosleep(&ts, &ts) < 0) {
+    }
+}
+
+static int connect_to_server(const char *server_ip, int server_port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family      = AF_INET;
+    server_addr.sin_port        = htons(server_port);
+    server_addr.sin_addr.s_addr = inet_addr(server_ip);
+
+    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("connect");
+        close(sockfd);
+        return -1;
+    }
+    int one = 1;
+    (void)setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { .tv_sec = REPLAY_TIMEOUT_SEC, .tv_usec = 0 };
+    (void)setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sockfd;
+}
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, 0);
+        if (n < 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Read up to len bytes; stops early on EOF, error or timeout. Returns
+// the number of bytes read.
+static size_t recv_upto(int fd, unsigned char *buf, size_t len) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = recv(fd, buf + total, len - total, 0);
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    return total;
+}
+
+// Whether the server's bytes from the first mismatch on, got[0..n), are
+// its REPLAY_CONFIG_DIFFERS refusal, in v1 or v2 framing. Reads the rest
+// of the message only once what has arrived could still be it.
+static int config_differs(int fd, unsigned char *got, size_t n) {
+    unsigned char want[2][V2_TEXT_MAX];
+    size_t want_len[2] = {
+        encode_message(want[0], REPLAY_CONFIG_DIFFERS),
+        v2_encode_text(want[1], REPLAY_CONFIG_DIFFERS, sizeof(REPLAY_CONFIG_DIFFERS) - 1),
+    };
+    for (int v = 0; v < 2; v++) {
+        size_t have = n < want_len[v] ? n : want_len[v];
+        if (memcmp(got, want[v], have) != 0) continue;
+        if (have < want_len[v]) have += recv_upto(fd, got + have, want_len[v] - have);
+        return have == want_len[v] && memcmp(got, want[v], have) == 0;
+    }
+    return 0;
+}
+
+struct totals {
+    long traces, ok, failed, frames_in, frames_out;
+};
+
+// Wait for the server frames in expect[0..len) and compare. first_out is
+// the index of the first record they came from, for the report.
+static int check_reply(int fd, const char *path, const struct cap_trace *t,
+                       size_t first_out, const unsigned char *expect, size_t len)
+{
+    static unsigned char got[(1 << 16) + V2_TEXT_MAX];
+    size_t n = recv_upto(fd, got, len);
+    size_t i = 0;
+    while (i < n && got[i] == expect[i]) i++;
+    if (i == len) return 0;
+
+    // Locate the record holding byte i.
+    size_t rec = first_out, off = i;
+    while (rec < t->n && (t->rec[rec].dir != CAP_OUT || off >= t->rec[rec].len)) {
+        if (t->rec[rec].dir == CAP_OUT) off -= t->rec[rec].len;
+        rec++;
+    }
+    if (config_differs(fd, got + i, n - i)) {
+        fprintf(stderr, "%s: %s: captured on a %u-word dictionary%s\n", path,
+                REPLAY_CONFIG_DIFFERS, t->hdr.num_words, t->hdr.evil ? " with --evil" : " without --evil");
+    } else if (i < n) {
+        fprintf(stderr, "%s: record %zu byte %zu: expected 0x%02x, got 0x%02x\n",
+                path, rec, off, expect[i], got[i]);
+    } else {
+        fprintf(stderr, "%s: record %zu: connection closed or timed out after %zu of %u bytes\n",
+                path, rec, off, t->rec[rec].len);
+    }
+    return -1;
+}
+
+static int replay_one(const char *ip, int port, double speed, const char *path,
+                      struct totals *tot)
+{
+    struct cap_trace t;
+    if (cap_load(path, &t) < 0) return -1;
+
+    static unsigned char expect[1 << 16];
+    int fd = -1;
+    int rc = 0;
+
+    // The welcome comes before anything we send; a busy server answers
+    // with server-overloaded instead, so retry until it has room.
+    size_t i = 0;
+    for (int tries = 0; tries < REPLAY_BUSY_RETRIES; tries++) {
+        fd = connect_to_server(ip, port);
+        if (fd < 0) {
+            cap_free(&t);
+            return -1;
+        }
+        unsigned char first[sizeof(overloaded) - 1];
+        size_t n = recv_upto(fd, first, 1);
+        if (n == 1 && first[0] == (unsigned char)overloaded[0] &&
+            recv_upto(fd, first + 1, sizeof(first) - 1) == sizeof(first) - 1 &&
+            memcmp(first, overloaded, sizeof(first)) == 0) {
+            close(fd);
+            fd = -1;
+            sleep_ns(20 * 1000000ull);
+            continue;
+        }
+        if (n == 1 && t.n > 0 && t.rec[0].dir == CAP_OUT && t.rec[0].len > 0 &&
+            first[0] == t.rec[0].data[0]) {
+            // First byte matches the welcome; check the rest below.
+            if (check_reply(fd, path, &t, 0, t.rec[0].data + 1, t.rec[0].len - 1) < 0) rc = -1;
+            tot->frames_out++;
+            i = 1;
+        } else {
+            fprintf(stderr, "%s: no welcome from server\n", path);
+            rc = -1;
+        }
+        break;
+    }
+    if (fd < 0) {
+        fprintf(stderr, "%s: server stayed busy\n", path);
+        cap_free(&t);
+        return -1;
+    }
+
+    int started = 0;
+    uint64_t ready_at = now_ns();
+    while (rc == 0 && i < t.n) {
+        const struct cap_record *r = &t.rec[i];
+        if (r->dir == CAP_OUT) {
+            size_t first_out = i, len = 0;
+            while (i < t.n && t.rec[i].dir == CAP_OUT) {
+                if (len + t.rec[i].len > sizeof(expect)) break;
+                memcpy(expect + len, t.rec[i].data, t.rec[i].len);
+                len += t.rec[i].len;
+                tot->frames_out++;
+                i++;
+            }
+            if (check_reply(fd, path, &t, first_out, expect, len) < 0) rc = -1;
+            ready_at = now_ns();
+            continue;
+        }
+
+        if (speed > 0) {
+            uint64_t due = ready_at + (uint64_t)((double)r->delta_us * 1000.0 / speed);
+            uint64_t now = now_ns();
+            if (due > now) sleep_ns(due - now);
+        }
+
+        unsigned char frame[1 + 255 + 1];
+        const unsigned char *out = r->data;
+        size_t out_len = r->len;
+        if (!started) {
+            // The start frame: pin the recorded word instead, keeping a
+            // v2 prefix ('V' + features) so the framing matches.
+            size_t pre = r->len > 1 && r->data[1] == START_V2 ? (r->len > 2 ? 2 : 1) : 0;
+            memcpy(frame + 1, r->data + 1, pre);
+            int k = snprintf((char *)frame + 1 + pre, sizeof(frame) - 1 - pre, "%c%u,%u,%u",
+                             START_REPLAY, t.hdr.word_idx, t.hdr.num_words, t.hdr.evil);
+            if (t.hdr.guessed) {
+                // A resumed game: pick up from the state it was resumed in.
+                unsigned misses = t.hdr.num_incorrect < MAX_INCORRECT ? t.hdr.num_incorrect : 0;
+                k += snprintf((char *)frame + 1 + pre + k, sizeof(frame) - 1 - pre - (size_t)k,
+                              ",%x,%.*s", t.hdr.guessed, (int)misses, (const char *)t.hdr.incorrect);
+            }
+            frame[0] = (unsigned char)(pre + (size_t)k);
+            out = frame;
+            out_len = 1 + pre + (size_t)k;
+            started = 1;
+        }
+        if (send_all(fd, out, out_len) < 0) {
+            fprintf(stderr, "%s: record %zu: send failed\n", path, i);
+            rc = -1;
+        }
+        tot->frames_in++;
+        i++;
+    }
+
+    if (rc == 0) {
+        // The server closes after Game Over (or once we hang up, for a
+        // game the player abandoned); anything more is a mismatch.
+        shutdown(fd, SHUT_WR);
+        unsigned char extra;
+        if (recv(fd, &extra, 1, 0) > 0) {
+            fprintf(stderr, "%s: server sent more than was captured\n", path);
+            rc = -1;
+        }
+    }
+    close(fd);
+    cap_free(&t);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <ip> <port> <1|10|max> <capture>...\n", argv[0]);
+        return 1;
+    }
+    const char *ip = argv[1];
+    int port = atoi(argv[2]);
+    double speed = strcmp(argv[3], "max") == 0 ? 0 : atof(argv[3]);
+    if (strcmp(argv[3], "max") != 0 && speed <= 0) {
+        fprintf(stderr, "speed must be a positive factor or \"max\"\n");
+        return 1;
+    }
+
+    struct totals tot;
+    memset(&tot, 0, sizeof(tot));
+    uint64_t t0 = now_ns();
+    for (int i = 4; i < argc; i++) {
+        tot.traces++;
+        if (replay_one(ip, port, speed, argv[i], &tot) == 0) tot.ok++;
+        else tot.failed++;
+    }
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    printf("Replayed %ld games at %s%s: %ld matched, %ld differed\n",
+           tot.traces, argv[3], speed > 0 ? "x" : " speed", tot.ok, tot.failed);
+    printf("%ld client frames, %ld server frames in %.3f s (%.0f frames/s)\n",
+           tot.frames_in, tot.frames_out, secs,
+           secs > 0 ? (double)(tot.frames_in + tot.frames_out) / secs : 0.0);
+    return tot.failed ? 1 : 0;
+}
@@ -0,0 +1,1324 @@
+#define _GNU_SOURCE     // memfd_create
+#include "hangman_room.h"
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "hangman_game.h"
+#include "hangman_proto.h"
+#include "hangman_match.h"
+#include "hangman_tourney.h"
+#include "hangman_leader.h"
+#include "hangman_stats.h"
+#include "hangman_metrics.h"
+
+#define ROOM_BUCKETS 1024
+#define FEED_BUCKETS 1024
+#define OUTQ_MAX     64     // frames queued on one member before it is dropped
+#define SPEC_Q_MAX   16     // frames queued on one spectator before skipping
+#define MAX_EVENTS   256
+
+// Child -> hub datagrams. JOIN and WATCH carry the client fd (SCM_RIGHTS).
+enum {
+    HUB_JOIN_ROOM = 1,
+    HUB_WATCH,
+    HUB_FRAME,          // one frame a solo session sent its player
+    HUB_SESSION_END,
+    HUB_MATCH,          // queue for a head-to-head race; id = rating
+    HUB_STATS,          // reply with hub statistics, then close
+    HUB_TOURNEY,        // join tournament id
+    HUB_RESULT,         // a named solo game finished (struct hub_result)
+    HUB_RANK,           // reply with a player's rank; data = name
+    HUB_DRAIN,          // parent is draining: stop answering metrics scrapes
+};
+
+struct hub_msg {
+    uint8_t       type;
+    uint8_t       kind;     // FEED_ROOM / FEED_SESSION for HUB_WATCH
+    uint16_t      len;      // bytes of data used (frame, result or name)
+    uint32_t      id;
+    unsigned char data[GAME_END_MAX];
+};
+
+#define HUB_MSG_HDR offsetof(struct hub_msg, data)
+
+struct hub_result {
+    uint64_t solve_ns;
+    uint8_t  won, misses;
+    char     name[LB_NAME_MAX + 1];
+};
+
+// Spectator counts per session, shared with every forked child so a solo
+// session only publishes frames while someone is watching. Indexed by
+// session id modulo WATCH_SLOTS; a collision only costs a wasted publish.
+#define WATCH_SLOTS (1 << 16)
+static uint16_t *watchers;
+static int       watch_fd = -1;
+
+// ---------- refcounted frames ----------
+
+// One encoded frame, shared by every member queue it sits on.
+struct outbuf {
+    int           refs;
+    size_t        len;
+    unsigned char data[];
+};
+
+static struct outbuf *outbuf_new(const unsigned char *data, size_t len) {
+    struct outbuf *b = malloc(sizeof(*b) + len);
+    if (!b) return NULL;
+    b->refs = 1;
+    b->len  = len;
+    memcpy(b->data, data, len);
+    return b;
+}
+
+static void outbuf_put(struct outbuf *b) {
+    if (--b->refs == 0) free(b);
+}
+
+// ---------- members and rooms ----------
+
+struct room;
+struct feed;
+struct race;
+struct tourney_hub;
+
+// A room player, a spectator attached to a feed, a player waiting in the
+// match queue, one side of a race, or a tournament player. At most one of
+// room, feed, race, tourney or queued is set (none for one-shot replies
+// such as stats).
+struct member {
+    int            fd;          // -1 once closed (freed at end of batch)
+    struct room   *room;
+    struct feed   *feed;
+    struct race   *race;
+    struct tourney_hub *tourney;
+    struct tourney_player *tp;
+    struct game    tg;          // tournament word in play
+    int            queued;
+    struct mm_entry mm;
+    int            slot;        // index in room->members / feed->specs, or race side
+    int            closing;     // close once the queue drains
+    int            http;        // metrics scrape: half-close once sent, ignore input
+    uint64_t       dropped;     // spectator frames skipped
+    unsigned char  in[1 + MSG_MAX];
+    size_t         in_len;
+    struct outbuf *q[OUTQ_MAX];
+    size_t         q_off;       // bytes of the head frame already sent
+    int            q_head, q_len;
+    struct member *next_free;
+};
+
+struct room {
+    uint32_t        id;
+    struct session  sess;
+    struct member **members;
+    int             n, cap;
+    int             over;       // game finished; unlinked from rooms[]
+    struct room    *next;       // hash chain
+    struct room    *next_free;
+};
+
+// Spectators of one room or solo session.
+struct feed {
+    int             kind;
+    uint32_t        id;
+    struct member **specs;
+    int             n, cap;
+    struct feed    *next;       // hash chain
+    struct feed    *next_free;
+};
+
+// Head-to-head race: both sides play their own board for the same word.
+struct race {
+    struct game    g[2];
+    struct member *p[2];
+    int            out[2];      // side finished: solved, lost, or left
+    struct race   *next_free;
+};
+
+// A running tournament and the connections playing in it. Players who
+// leave keep their place in the standings.
+struct tourney_hub {
+    struct tourney      t;
+    int                 connected;
+    int                 ended;      // final standings sent; unlinked
+    struct tourney_hub *next;       // active list
+    struct tourney_hub *next_free;
+};
+
+static struct room   *rooms[ROOM_BUCKETS];
+static struct feed   *feeds[FEED_BUCKETS];
+static struct member *dead_members;
+static struct room   *dead_rooms;
+static struct feed   *dead_feeds;
+static struct race   *dead_races;
+static struct tourney_hub *tourneys;
+static struct tourney_hub *dead_tourneys;
+static struct mm_queue match_queue;
+static struct leaderboard leaders;
+static int            epfd = -1;
+static const struct word_index *hub_ix;
+static int            hub_evil;
+static int            hub_metrics_fd = -1;
+
+static struct room **room_bucket(uint32_t id) {
+    return &rooms[(id * 2654435761u) % ROOM_BUCKETS];
+}
+
+static void room_unlink(struct room *r) {
+    for (struct room **p = room_bucket(r->id); *p; p = &(*p)->next) {
+        if (*p == r) {
+            *p = r->next;
+            return;
+        }
+    }
+}
+
+static struct room *room_get(uint32_t id) {
+    struct room **bucket = room_bucket(id);
+    for (struct room *r = *bucket; r; r = r->next) {
+        if (r->id == id) return r;
+    }
+
+    struct room *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    if (session_start(&r->sess, hub_ix, rand() % num_words, hub_evil) < 0) {
+        free(r);
+        return NULL;
+    }
+    r->id = id;
+    r->next = *bucket;
+    *bucket = r;
+    return r;
+}
+
+static struct feed **feed_bucket(int kind, uint32_t id) {
+    return &feeds[((id ^ ((uint32_t)kind << 31)) * 2654435761u) % FEED_BUCKETS];
+}
+
+static struct feed *feed_find(int kind, uint32_t id) {
+    for (struct feed *f = *feed_bucket(kind, id); f; f = f->next) {
+        if (f->kind == kind && f->id == id) return f;
+    }
+    return NULL;
+}
+
+static void feed_detach(struct member *m) {
+    struct feed *f = m->feed;
+    f->specs[m->slot] = f->specs[--f->n];
+    f->specs[m->slot]->slot = m->slot;
+    if (f->kind == FEED_SESSION) {
+        __atomic_sub_fetch(&watchers[f->id % WATCH_SLOTS], 1, __ATOMIC_RELAXED);
+    }
+    if (f->n == 0) {
+        for (struct feed **p = feed_bucket(f->kind, f->id); *p; p = &(*p)->next) {
+            if (*p == f) {
+                *p = f->next;
+                break;
+            }
+        }
+        f->next_free = dead_feeds;
+        dead_feeds = f;
+    }
+}
+
+static void member_send_bytes(struct member *m, const unsigned char *data, size_t len);
+
+static void member_send_msg(struct member *m, const char *msg) {
+    unsigned char pkt[MESSAGE_PKT_MAX];
+    member_send_bytes(m, pkt, encode_message(pkt, msg));
+}
+
+static void race_leave(struct member *m) {
+    struct race *r = m->race;
+    int side = m->slot;
+    r->p[side] = NULL;
+
+    struct member *other = r->p[!side];
+    if (!r->out[side] && other && !r->out[!side]) {
+        member_send_msg(other, "Opponent left");
+    }
+    r->out[side] = 1;
+    if (!other) {
+        r->next_free = dead_races;
+        dead_races = r;
+    }
+}
+
+static void set_events(struct member *m, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = m };
+    (void)epoll_ctl(epfd, EPOLL_CTL_MOD, m->fd, &ev);
+}
+
+// Close m and detach it from its room or feed. Memory is released after
+// the current epoll batch so stale events and loops over members never
+// touch freed memory.
+static void member_kill(struct member *m) {
+    if (m->fd < 0) return;
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, m->fd, NULL);
+    close(m->fd);
+    m->fd = -1;
+    for (; m->q_len > 0; m->q_len--) {
+        outbuf_put(m->q[m->q_head]);
+        m->q_head = (m->q_head + 1) % OUTQ_MAX;
+    }
+
+    if (m->feed) {
+        feed_detach(m);
+    } else if (m->queued) {
+        mm_remove(&match_queue, &m->mm);
+    } else if (m->race) {
+        race_leave(m);
+    } else if (m->tourney) {
+        struct tourney_hub *th = m->tourney;
+        m->tp->owner = NULL;
+        if (--th->connected == 0 && th->ended) {
+            th->next_free = dead_tourneys;
+            dead_tourneys = th;
+        }
+    } else if (m->room) {
+        struct room *r = m->room;
+        r->members[m->slot] = r->members[--r->n];
+        r->members[m->slot]->slot = m->slot;
+        if (r->n == 0) {
+            if (!r->over) room_unlink(r);
+            r->next_free = dead_rooms;
+            dead_rooms = r;
+        }
+    }
+
+    m->next_free = dead_members;
+    dead_members = m;
+}
+
+static void release_dead(void) {
+    while (dead_members) {
+        struct member *m = dead_members;
+        dead_members = m->next_free;
+        free(m);
+    }
+    while (dead_rooms) {
+        struct room *r = dead_rooms;
+        dead_rooms = r->next_free;
+        session_end(&r->sess);
+        free(r->members);
+        free(r);
+    }
+    while (dead_feeds) {
+        struct feed *f = dead_feeds;
+        dead_feeds = f->next_free;
+        free(f->specs);
+        free(f);
+    }
+    while (dead_races) {
+        struct race *r = dead_races;
+        dead_races = r->next_free;
+        free(r);
+    }
+    while (dead_tourneys) {
+        struct tourney_hub *th = dead_tourneys;
+        dead_tourneys = th->next_free;
+        tourney_free(&th->t);
+        free(th);
+    }
+}
+
+// Write as much of m's queue as the socket takes.
+static void member_flush(struct member *m) {
+    while (m->q_len > 0) {
+        struct outbuf *b = m->q[m->q_head];
+        ssize_t k = send(m->fd, b->data + m->q_off, b->len - m->q_off,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (k < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            member_kill(m);
+            return;
+        }
+        m->q_off += (size_t)k;
+        if (m->q_off < b->len) return;
+
+        outbuf_put(b);
+        m->q_off = 0;
+        m->q_head = (m->q_head + 1) % OUTQ_MAX;
+        m->q_len--;
+        if (m->q_len == 0) set_events(m, EPOLLIN);
+    }
+    if (m->closing) {
+        member_kill(m);
+    } else if (m->http) {
+        // Let the scraper read to EOF and close first; closing here with
+        // its request unread would reset the connection.
+        (void)shutdown(m->fd, SHUT_WR);
+    }
+}
+
+// Queue b on m (taking a reference) and try to send it right away.
+static void member_send(struct member *m, struct outbuf *b) {
+    if (m->fd < 0) return;
+    if (m->feed && m->q_len == SPEC_Q_MAX) {
+        // Slow spectator: never grow the queue. A new board supersedes
+        // everything not yet on the wire (skip to latest); a message that
+        // does not fit is dropped.
+        if (b->len == 0 || b->data[0] != 0) {
+            m->dropped++;
+            return;
+        }
+        int keep = m->q_off > 0 ? 1 : 0;
+        while (m->q_len > keep) {
+            int tail = (m->q_head + m->q_len - 1) % OUTQ_MAX;
+            outbuf_put(m->q[tail]);
+            m->q_len--;
+            m->dropped++;
+        }
+        if (m->q_len == 0) m->q_off = 0;
+    } else if (m->q_len == OUTQ_MAX) {
+        // Too far behind to ever catch up.
+        member_kill(m);
+        return;
+    }
+
+    b->refs++;
+    m->q[(m->q_head + m->q_len) % OUTQ_MAX] = b;
+    if (m->q_len++ == 0) {
+        member_flush(m);
+        if (m->fd >= 0 && m->q_len > 0) set_events(m, EPOLLIN | EPOLLOUT);
+    }
+}
+
+// Queue b on every spectator of (kind, id).
+static void feed_publish(int kind, uint32_t id, struct outbuf *b) {
+    struct feed *f = feed_find(kind, id);
+    if (!f) return;
+    // Backwards: member_kill swaps the last entry into the dead slot.
+    for (int i = f->n - 1; i >= 0; i--) {
+        member_send(f->specs[i], b);
+    }
+}
+
+// The watched game is over: close its spectators once they drain.
+static void feed_close(int kind, uint32_t id) {
+    struct feed *f = feed_find(kind, id);
+    if (!f) return;
+    for (int i = f->n - 1; i >= 0; i--) {
+        struct member *m = f->specs[i];
+        m->closing = 1;
+        if (m->q_len == 0) member_kill(m);
+    }
+}
+
+// Send one encoded frame to every member and spectator of r.
+static void room_broadcast(struct room *r, const unsigned char *data, size_t len) {
+    struct outbuf *b = outbuf_new(data, len);
+    if (!b) return;
+    // Backwards: member_kill swaps the last member into the dead slot.
+    for (int i = r->n - 1; i >= 0; i--) {
+        member_send(r->members[i], b);
+    }
+    feed_publish(FEED_ROOM, r->id, b);
+    outbuf_put(b);
+}
+
+static void member_send_bytes(struct member *m, const unsigned char *data, size_t len) {
+    struct outbuf *b = outbuf_new(data, len);
+    if (!b) return;
+    member_send(m, b);
+    outbuf_put(b);
+}
+
+static void room_send_board(struct room *r, struct member *only) {
+    const struct game *g = &r->sess.g;
+    unsigned char pkt[GAME_STATE_MAX];
+    size_t len = encode_game_state(pkt, g->masked, g->incorrect,
+                                   g->word_len, g->num_incorrect);
+    if (only) {
+        member_send_bytes(only, pkt, len);
+    } else {
+        room_broadcast(r, pkt, len);
+    }
+}
+
+// ---------- game frames ----------
+
+static void room_guess(struct room *r, unsigned char letter) {
+    struct game *g = &r->sess.g;
+    if (r->over) return;
+
+    (void)session_guess(&r->sess, (unsigned char)tolower(letter));
+
+    if (game_won(g) || game_lost(g)) {
+        unsigned char end[GAME_END_MAX];
+        size_t len = encode_game_end(end, game_secret(g), game_won(g));
+
+        // Next join with this id starts a fresh room.
+        r->over = 1;
+        room_unlink(r);
+        room_broadcast(r, end, len);
+        feed_close(FEED_ROOM, r->id);
+        for (int i = r->n - 1; i >= 0; i--) {
+            struct member *m = r->members[i];
+            m->closing = 1;
+            if (m->q_len == 0) member_kill(m);
+        }
+        return;
+    }
+
+    room_send_board(r, NULL);
+}
+
+// ---------- races ----------
+
+static void race_send_board(struct race *r, int side) {
+    const struct game *g = &r->g[side];
+    unsigned char pkt[GAME_STATE_MAX];
+    member_send_bytes(r->p[side], pkt,
+                      encode_game_state(pkt, g->masked, g->incorrect,
+                                        g->word_len, g->num_incorrect));
+}
+
+// Finish one side: end-of-game messages, then close once sent.
+static void race_finish(struct race *r, int side, int won) {
+    struct member *m = r->p[side];
+    unsigned char end[GAME_END_MAX];
+    size_t len = encode_game_end(end, game_secret(&r->g[side]), won);
+
+    r->out[side] = 1;
+    member_send_bytes(m, end, len);
+    m->closing = 1;
+    if (m->fd >= 0 && m->q_len == 0) member_kill(m);
+}
+
+static void race_start(struct member *a, struct member *b) {
+    struct race *r = calloc(1, sizeof(*r));
+    if (!r) {
+        // Both are out of the queue already: mm_remove must not see them again.
+        a->queued = 0;
+        b->queued = 0;
+        member_kill(a);
+        member_kill(b);
+        return;
+    }
+
+    int word_idx = rand() % num_words;
+    struct member *p[2] = { a, b };
+    for (int side = 0; side < 2; side++) {
+        game_init(&r->g[side], word_idx);
+        r->p[side] = p[side];
+        p[side]->queued = 0;
+        p[side]->race = r;
+        p[side]->slot = side;
+    }
+    for (int side = 0; side < 2; side++) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Matched against rating %d", p[!side]->mm.rating);
+        member_send_msg(p[side], msg);
+        if (r->p[side]) race_send_board(r, side);
+    }
+}
+
+static void race_matched(struct mm_entry *a, struct mm_entry *b, void *arg) {
+    (void)arg;
+    race_start(a->owner, b->owner);
+}
+
+static void race_guess(struct member *m, unsigned char letter) {
+    struct race *r = m->race;
+    int side = m->slot;
+    if (r->out[side]) return;
+
+    struct game *g = &r->g[side];
+    (void)game_guess(g, (unsigned char)tolower(letter));
+
+    if (game_won(g)) {
+        race_finish(r, side, 1);
+        if (r->p[!side] && !r->out[!side]) {
+            member_send_msg(r->p[!side], "Opponent solved it first");
+            race_finish(r, !side, 0);
+        }
+    } else if (game_lost(g)) {
+        race_finish(r, side, 0);
+    } else {
+        race_send_board(r, side);
+    }
+}
+
+// ---------- tournaments ----------
+
+static void tourney_send_word(struct member *m) {
+    const struct tourney *t = &m->tourney->t;
+    struct game *g = &m->tg;
+    unsigned char pkt[GAME_STATE_MAX];
+
+    game_init(g, t->words[m->tp->word]);
+    member_send_bytes(m, pkt, encode_game_state(pkt, g->masked, g->incorrect,
+                                                g->word_len, g->num_incorrect));
+    // The clock starts once the board is on its way.
+    m->tp->word_start_ns = now_ns();
+}
+
+// Top rows of the ranking as message packets, appended at out.
+static size_t encode_standings(const struct tourney_hub *th, unsigned char *out,
+                               const char *title) {
+    const struct tourney *t = &th->t;
+    char line[MSG_MAX + 1];
+    size_t len = encode_message(out, title);
+    for (int i = 0; i < t->n && i < TOURNEY_TOP; i++) {
+        tourney_row(t, i, line, sizeof(line));
+        len += encode_message(out + len, line);
+    }
+    return len;
+}
+
+// Push the standings to every connected player: encoded once, one shared
+// buffer queued on each. Reads only the top of the ranking.
+static void tourney_push(struct tourney_hub *th, uint64_t now) {
+    const struct tourney *t = &th->t;
+    unsigned char pkt[(TOURNEY_TOP + 1) * MESSAGE_PKT_MAX];
+    char title[64];
+    snprintf(title, sizeof(title), "Standings (%d players, %llus left)", t->n,
+             (unsigned long long)((t->end_ns - now) / 1000000000ull));
+
+    struct outbuf *b = outbuf_new(pkt, encode_standings(th, pkt, title));
+    if (!b) return;
+    for (int i = 0; i < t->n; i++) {
+        struct member *m = t->ranking[i]->owner;
+        if (m) member_send(m, b);
+    }
+    outbuf_put(b);
+}
+
+// Time is up: final standings, each player's own rank, then close.
+static void tourney_end(struct tourney_hub *th) {
+    struct tourney *t = &th->t;
+    unsigned char pkt[(TOURNEY_TOP + 2) * MESSAGE_PKT_MAX];
+    size_t len = encode_standings(th, pkt, "Final standings");
+    len += encode_message(pkt + len, "Game Over!");
+
+    // The last member_kill below queues th for release.
+    th->ended = 1;
+    if (th->connected == 0) {
+        th->next_free = dead_tourneys;
+        dead_tourneys = th;
+        return;
+    }
+    struct outbuf *b = outbuf_new(pkt, len);
+    for (int i = 0; i < t->n; i++) {
+        struct member *m = t->ranking[i]->owner;
+        if (!m) continue;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Your rank: %d of %d", i + 1, t->n);
+        member_send_msg(m, msg);
+        if (b) member_send(m, b);
+        m->closing = 1;
+        if (m->fd >= 0 && m->q_len == 0) member_kill(m);
+    }
+    if (b) outbuf_put(b);
+}
+
+static void tourney_tick(uint64_t now) {
+    for (struct tourney_hub **p = &tourneys; *p;) {
+        struct tourney_hub *th = *p;
+        struct tourney *t = &th->t;
+        if (now >= t->end_ns) {
+            *p = th->next;
+            tourney_end(th);
+            continue;
+        }
+        if (now >= t->next_push_ns) {
+            tourney_push(th, now);
+            while (t->next_push_ns <= now) {
+                t->next_push_ns += (uint64_t)TOURNEY_STANDINGS_MS * 1000000ull;
+            }
+        }
+        p = &th->next;
+    }
+}
+
+static void tourney_guess(struct member *m, unsigned char letter) {
+    struct tourney_hub *th = m->tourney;
+    struct tourney_player *tp = m->tp;
+    struct game *g = &m->tg;
+    if (th->ended || tp->word >= TOURNEY_WORDS) return;
+
+    (void)game_guess(g, (unsigned char)tolower(letter));
+    if (!game_won(g) && !game_lost(g)) {
+        unsigned char pkt[GAME_STATE_MAX];
+        member_send_bytes(m, pkt, encode_game_state(pkt, g->masked, g->incorrect,
+                                                    g->word_len, g->num_incorrect));
+        return;
+    }
+
+    uint64_t now = now_ns();
+    uint64_t word_ns = now - tp->word_start_ns;
+    int won = game_won(g);
+    int rank = tourney_finish_word(&th->t, tp, won, g->num_incorrect, now);
+
+    char msg[MSG_MAX + 1];
+    int pos = snprintf(msg, sizeof(msg), "The word was");
+    for (const char *c = game_secret(g); *c; c++) {
+        pos += snprintf(msg + pos, sizeof(msg) - (size_t)pos, " %c", *c);
+    }
+    member_send_msg(m, msg);
+    snprintf(msg, sizeof(msg), "%s in %llu.%03llus, rank %d of %d",
+             won ? "Solved" : "Missed",
+             (unsigned long long)(word_ns / 1000000000ull),
+             (unsigned long long)(word_ns / 1000000ull % 1000), rank + 1, th->t.n);
+    member_send_msg(m, msg);
+    if (m->fd < 0) return;
+
+    if (tp->word < TOURNEY_WORDS) {
+        tourney_send_word(m);
+    } else {
+        member_send_msg(m, "All words done; final standings when time is up");
+    }
+}
+
+static void member_frame(struct member *m, const unsigned char *frame) {
+    struct room *r = m->room;
+    unsigned char len = frame[0];
+
+    if (m->race && len == 1) {
+        race_guess(m, frame[1]);
+        return;
+    }
+    if (m->race && len == 0) {
+        member_send_msg(m, "No hints in races");
+        return;
+    }
+    if (m->tourney && len == 1) {
+        tourney_guess(m, frame[1]);
+        return;
+    }
+    if (m->tourney && len == 0) {
+        member_send_msg(m, "No hints in tournaments");
+        return;
+    }
+    if (!r) return;   // spectators are read-only, queued players wait
+
+    if (len == 1) {
+        room_guess(r, frame[1]);
+    } else if (len == 0 && !r->over) {
+        // Hint: answer only the member who asked.
+        int best = session_hint(&r->sess, hub_ix);
+        char hint_msg[16] = "Hint: none";
+        if (best > 0) snprintf(hint_msg, sizeof(hint_msg), "Hint: %c", best);
+        unsigned char pkt[MESSAGE_PKT_MAX];
+        member_send_bytes(m, pkt, encode_message(pkt, hint_msg));
+    }
+    // anything else: invalid guess packet, ignore
+}
+
+static void member_read(struct member *m) {
+    for (;;) {
+        ssize_t k = recv(m->fd, m->in + m->in_len, sizeof(m->in) - m->in_len, 0);
+        if (k == 0 || (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            member_kill(m);
+            return;
+        }
+        if (k < 0) return;
+        if (m->http) continue;
+        m->in_len += (size_t)k;
+
+        size_t off = 0;
+        while (m->fd >= 0 && m->in_len - off >= 1 &&
+               m->in_len - off >= 1 + (size_t)m->in[off]) {
+            member_frame(m, m->in + off);
+            off += 1 + (size_t)m->in[off];
+        }
+        if (m->fd < 0) return;
+        memmove(m->in, m->in + off, m->in_len - off);
+        m->in_len -= off;
+    }
+}
+
+// ---------- child side ----------
+
+int hub_setup(int map_fd) {
+    size_t size = WATCH_SLOTS * sizeof(*watchers);
+    if (map_fd < 0) {
+        map_fd = memfd_create("hangman_watchers", MFD_CLOEXEC);
+        if (map_fd < 0 || ftruncate(map_fd, (off_t)size) < 0) {
+            if (map_fd >= 0) close(map_fd);
+            return -1;
+        }
+    }
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    if (p == MAP_FAILED) {
+        close(map_fd);
+        return -1;
+    }
+    watchers = p;
+    watch_fd = map_fd;
+    return 0;
+}
+
+int hub_map_fd(void) {
+    return watch_fd;
+}
+
+static int send_with_fd(int hub_fd, const struct hub_msg *msg, size_t len, int fd) {
+    struct iovec iov = { .iov_base = (void *)msg, .iov_len = len };
+
+    union {
+        char           buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+
+    struct msghdr mh = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = ctl.buf,
+        .msg_controllen = sizeof(ctl.buf),
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+
+    return sendmsg(hub_fd, &mh, 0) == (ssize_t)len ? 0 : -1;
+}
+
+int room_handoff(int hub_fd, uint32_t room_id, int client_fd) {
+    struct hub_msg msg = { .type = HUB_JOIN_ROOM, .id = room_id };
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR, client_fd);
+}
+
+int hub_watch(int hub_fd, int kind, uint32_t id, int client_fd) {
+    struct hub_msg msg = { .type = HUB_WATCH, .kind = (uint8_t)kind, .id = id };
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR, client_fd);
+}
+
+int hub_match(int hub_fd, int rating, int client_fd) {
+    struct hub_msg msg = { .type = HUB_MATCH, .id = (uint32_t)rating };
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR, client_fd);
+}
+
+int hub_tourney(int hub_fd, uint32_t tourney_id, int client_fd) {
+    struct hub_msg msg = { .type = HUB_TOURNEY, .id = tourney_id };
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR, client_fd);
+}
+
+int hub_stats(int hub_fd, int client_fd) {
+    struct hub_msg msg = { .type = HUB_STATS };
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR, client_fd);
+}
+
+int hub_rank(int hub_fd, const char *name, int client_fd) {
+    struct hub_msg msg = { .type = HUB_RANK };
+    size_t len = strnlen(name, LB_NAME_MAX);
+    memcpy(msg.data, name, len);
+    msg.len = (uint16_t)len;
+    return send_with_fd(hub_fd, &msg, HUB_MSG_HDR + len, client_fd);
+}
+
+void hub_result(int hub_fd, const char *name, int won, int misses, uint64_t solve_ns) {
+    struct hub_msg msg = { .type = HUB_RESULT };
+    struct hub_result res = {
+        .solve_ns = solve_ns,
+        .won      = (uint8_t)(won != 0),
+        .misses   = (uint8_t)misses,
+    };
+    size_t len = strnlen(name, LB_NAME_MAX);
+    memcpy(res.name, name, len);
+    memcpy(msg.data, &res, sizeof(res));
+    msg.len = sizeof(res);
+    // Never block the player: a result the hub has no room for is lost.
+    (void)send(hub_fd, &msg, HUB_MSG_HDR + sizeof(res), MSG_DONTWAIT);
+}
+
+int hub_session_watched(uint32_t session_id) {
+    return __atomic_load_n(&watchers[session_id % WATCH_SLOTS], __ATOMIC_RELAXED) != 0;
+}
+
+void hub_publish(int hub_fd, uint32_t session_id, const unsigned char *frame, size_t len) {
+    struct hub_msg msg = { .type = HUB_FRAME, .id = session_id };
+    if (len > sizeof(msg.data)) return;
+    msg.len = (uint16_t)len;
+    memcpy(msg.data, frame, len);
+    // Never block the player: if the hub is behind, spectators miss this.
+    (void)send(hub_fd, &msg, HUB_MSG_HDR + len, MSG_DONTWAIT);
+}
+
+void hub_session_end(int hub_fd, uint32_t session_id) {
+    struct hub_msg msg = { .type = HUB_SESSION_END, .id = session_id };
+    (void)send(hub_fd, &msg, HUB_MSG_HDR, MSG_DONTWAIT);
+}
+
+void hub_drain(int hub_fd) {
+    struct hub_msg msg = { .type = HUB_DRAIN };
+    (void)send(hub_fd, &msg, HUB_MSG_HDR, 0);
+}
+
+// ---------- hub side ----------
+
+static void room_join(uint32_t room_id, int fd);
+
+// Receive one child datagram. Returns the passed fd, -1 if the socket is
+// drained or failed (see errno), or -2 for a message without an fd.
+static int recv_hub_msg(int ctl_fd, struct hub_msg *msg, ssize_t *len) {
+    struct iovec iov = { .iov_base = msg, .iov_len = sizeof(*msg) };
+    union {
+        char           buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+
+    struct msghdr mh = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = ctl.buf,
+        .msg_controllen = sizeof(ctl.buf),
+    };
+    *len = recvmsg(ctl_fd, &mh, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (*len < 0) return -1;
+
+    int fd = -2;
+    struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+    if (c && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+        memcpy(&fd, CMSG_DATA(c), sizeof(int));
+    }
+    return fd;
+}
+
+static struct member *member_new(int fd) {
+    struct member *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    m->fd = fd;
+    return m;
+}
+
+static int member_watch_events(struct member *m) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = m };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, m->fd, &ev) < 0) {
+        perror("epoll_ctl");
+        member_kill(m);
+        return -1;
+    }
+    return 0;
+}
+
+static void spectator_attach(int kind, uint32_t id, int fd) {
+    struct feed *f = feed_find(kind, id);
+    if (!f) {
+        f = calloc(1, sizeof(*f));
+        if (!f) {
+            close(fd);
+            return;
+        }
+        f->kind = kind;
+        f->id   = id;
+        struct feed **bucket = feed_bucket(kind, id);
+        f->next = *bucket;
+        *bucket = f;
+    }
+
+    if (f->n == f->cap) {
+        int cap = f->cap ? f->cap * 2 : 8;
+        void *p = realloc(f->specs, (size_t)cap * sizeof(*f->specs));
+        if (p) {
+            f->specs = p;
+            f->cap = cap;
+        }
+    }
+    struct member *m = f->n < f->cap ? member_new(fd) : NULL;
+    if (!m) {
+        // An empty feed is harmless; it goes away with its next spectator.
+        close(fd);
+        return;
+    }
+
+    m->feed = f;
+    m->slot = f->n;
+    f->specs[f->n++] = m;
+    if (kind == FEED_SESSION) {
+        __atomic_add_fetch(&watchers[id % WATCH_SLOTS], 1, __ATOMIC_RELAXED);
+    }
+    if (member_watch_events(m) < 0) return;
+
+    char hello[48];
+    snprintf(hello, sizeof(hello), "Watching %s %u",
+             kind == FEED_ROOM ? "room" : "session", id);
+    unsigned char pkt[MESSAGE_PKT_MAX];
+    member_send_bytes(m, pkt, encode_message(pkt, hello));
+
+    // Rooms live here, so a room spectator gets the board right away; a
+    // solo session's next frame arrives once its child sees the flag.
+    if (kind == FEED_ROOM) {
+        for (struct room *r = *room_bucket(id); r; r = r->next) {
+            if (r->id == id && m->fd >= 0) room_send_board(r, m);
+        }
+    }
+}
+
+static void match_join(int rating, int fd) {
+    struct member *m = member_new(fd);
+    if (!m) {
+        close(fd);
+        return;
+    }
+    m->queued = 1;
+    m->mm.rating = rating;
+    if (member_watch_events(m) < 0) return;
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Waiting for an opponent (rating %d)", rating);
+    member_send_msg(m, msg);
+    if (m->fd < 0) return;
+
+    struct mm_entry *opp = mm_enqueue(&match_queue, &m->mm, m, rating, now_ns());
+    if (opp) race_start(opp->owner, m);
+}
+
+static void tourney_join_fd(uint32_t id, int fd) {
+    uint64_t now = now_ns();
+    struct tourney_hub *th = tourneys;
+    while (th && th->t.id != id) th = th->next;
+    if (!th) {
+        th = calloc(1, sizeof(*th));
+        if (!th) {
+            close(fd);
+            return;
+        }
+        tourney_init(&th->t, id, now);
+        th->next = tourneys;
+        tourneys = th;
+    }
+
+    struct member *m = member_new(fd);
+    struct tourney_player *tp = m ? tourney_join(&th->t, m, now) : NULL;
+    if (!tp) {
+        free(m);
+        close(fd);
+        return;
+    }
+    m->tourney = th;
+    m->tp = tp;
+    th->connected++;
+    if (member_watch_events(m) < 0) return;
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Tournament %u: you are #%u, %d words, %llus left",
+             id, tp->num, TOURNEY_WORDS,
+             (unsigned long long)((th->t.end_ns - now) / 1000000000ull));
+    member_send_msg(m, msg);
+    if (m->fd >= 0) tourney_send_word(m);
+}
+
+// Plain-text statistics for operators, one message per line.
+static void send_stats(int fd) {
+    struct member *m = member_new(fd);
+    if (!m) {
+        close(fd);
+        return;
+    }
+    if (member_watch_events(m) < 0) return;
+
+    char line[MSG_MAX + 1];
+    const struct stats_segment *seg = stats_segment();
+    if (seg) {
+        uint64_t total[STAT_COUNT];
+        stats_total(seg, total);
+        int pos = snprintf(line, sizeof(line), "solo");
+        for (int c = 0; c < STAT_COUNT; c++) {
+            pos += snprintf(line + pos, sizeof(line) - (size_t)pos, " %s %llu",
+                            stat_names[c], (unsigned long long)total[c]);
+        }
+        member_send_msg(m, line);
+    }
+    snprintf(line, sizeof(line), "match waiting %zu matched %llu",
+             match_queue.waiting, (unsigned long long)match_queue.matched);
+    member_send_msg(m, line);
+    for (int k = 0; k < MM_HIST_BUCKETS; k++) {
+        if (!match_queue.wait_hist[k]) continue;
+        snprintf(line, sizeof(line), "match wait < %llu us: %llu",
+                 1ull << k, (unsigned long long)match_queue.wait_hist[k]);
+        member_send_msg(m, line);
+    }
+    member_send_msg(m, "Game Over!");
+    m->closing = 1;
+    if (m->fd >= 0 && m->q_len == 0) member_kill(m);
+}
+
+// One player's leaderboard line, then close.
+static void send_rank(const char *name, int fd) {
+    struct member *m = member_new(fd);
+    if (!m) {
+        close(fd);
+        return;
+    }
+    if (member_watch_events(m) < 0) return;
+
+    char line[MSG_MAX + 1];
+    const struct lb_player *p = lb_find(&leaders, name);
+    if (!p) {
+        snprintf(line, sizeof(line), "%s has no finished games", name);
+        member_send_msg(m, line);
+    } else {
+        size_t rank = lb_rank(&leaders, p->score);
+        snprintf(line, sizeof(line), "%s: rank %zu of %zu (top %.1f%%), score %u",
+                 p->name, rank, leaders.n, 100.0 * (double)rank / (double)leaders.n,
+                 p->score);
+        member_send_msg(m, line);
+        uint64_t avg_ms = p->wins ? p->solve_ns / p->wins / 1000000ull : 0;
+        snprintf(line, sizeof(line),
+                 "%u wins, %u losses, %llu misses, avg solve %llu.%03llus",
+                 p->wins, p->losses, (unsigned long long)p->misses,
+                 (unsigned long long)(avg_ms / 1000), (unsigned long long)(avg_ms % 1000));
+        member_send_msg(m, line);
+    }
+    member_send_msg(m, "Game Over!");
+    m->closing = 1;
+    if (m->fd >= 0 && m->q_len == 0) member_kill(m);
+}
+
+// Metrics scrapes: answer every pending connection with one HTTP/1.0
+// response built from the shared stats segment, plus the match waits
+// only the hub knows.
+static void metrics_accept(int lfd) {
+    // Body rendered after room for the header, which is then written
+    // right in front of it so the response is one contiguous buffer.
+    enum { HDR_ROOM = 256, BODY_MAX = METRICS_MAX + METRICS_LOG2_MAX(MM_HIST_BUCKETS) };
+    static char resp[HDR_ROOM + BODY_MAX];
+
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept metrics");
+            }
+            return;
+        }
+        struct member *m = member_new(fd);
+        if (!m) {
+            close(fd);
+            continue;
+        }
+        m->http = 1;
+        if (member_watch_events(m) < 0) continue;
+
+        const struct stats_segment *seg = stats_segment();
+        size_t body = 0;
+        if (seg) {
+            body = metrics_render(seg, resp + HDR_ROOM, METRICS_MAX);
+            body += metrics_render_log2("hangman_match_wait_seconds",
+                                        "Race queue join to opponent found.",
+                                        match_queue.wait_hist, MM_HIST_BUCKETS,
+                                        match_queue.wait_sum_us, 1e6,
+                                        resp + HDR_ROOM + body, BODY_MAX - body);
+        }
+        char hdr[HDR_ROOM];
+        int h = snprintf(hdr, sizeof(hdr),
+                         "HTTP/1.0 %s\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\n"
+                         "Connection: close\r\n\r\n",
+                         seg ? "200 OK" : "503 Service Unavailable", body);
+        memcpy(resp + HDR_ROOM - h, hdr, (size_t)h);
+        member_send_bytes(m, (const unsigned char *)resp + HDR_ROOM - h, (size_t)h + body);
+    }
+}
+
+static void handle_hub_msg(const struct hub_msg *msg, ssize_t len, int fd) {
+    if (len < (ssize_t)HUB_MSG_HDR) {
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    switch (msg->type) {
+    case HUB_JOIN_ROOM:
+        if (fd >= 0) room_join(msg->id, fd);
+        return;
+    case HUB_WATCH:
+        if (fd >= 0) spectator_attach(msg->kind, msg->id, fd);
+        return;
+    case HUB_MATCH:
+        if (fd >= 0) match_join((int)msg->id, fd);
+        return;
+    case HUB_STATS:
+        if (fd >= 0) send_stats(fd);
+        return;
+    case HUB_TOURNEY:
+        if (fd >= 0) tourney_join_fd(msg->id, fd);
+        return;
+    case HUB_RANK:
+        if (fd >= 0) {
+            char name[LB_NAME_MAX + 1];
+            size_t n = (size_t)(len - (ssize_t)HUB_MSG_HDR);
+            if (n > LB_NAME_MAX) n = LB_NAME_MAX;
+            memcpy(name, msg->data, n);
+            name[n] = '\0';
+            send_rank(name, fd);
+        }
+        return;
+    case HUB_RESULT:
+        if (len - (ssize_t)HUB_MSG_HDR == (ssize_t)sizeof(struct hub_result)) {
+            struct hub_result res;
+            memcpy(&res, msg->data, sizeof(res));
+            res.name[LB_NAME_MAX] = '\0';
+            if (lb_record(&leaders, res.name, res.won, res.misses, res.solve_ns) < 0) {
+                perror("lb_record");
+            }
+        }
+        break;
+    case HUB_FRAME:
+        if (msg->len <= len - (ssize_t)HUB_MSG_HDR) {
+            struct outbuf *b = outbuf_new(msg->data, msg->len);
+            if (b) {
+                feed_publish(FEED_SESSION, msg->id, b);
+                outbuf_put(b);
+            }
+        }
+        break;
+    case HUB_SESSION_END:
+        feed_close(FEED_SESSION, msg->id);
+        break;
+    case HUB_DRAIN:
+        // A proxy probes the metrics listener for health: once the last
+        // copy is closed it is refused, and the proxy routes around us.
+        if (hub_metrics_fd >= 0) {
+            (void)epoll_ctl(epfd, EPOLL_CTL_DEL, hub_metrics_fd, NULL);
+            close(hub_metrics_fd);
+            hub_metrics_fd = -1;
+        }
+        break;
+    }
+    if (fd >= 0) close(fd);
+}
+
+static void room_join(uint32_t room_id, int fd) {
+    struct room *r = room_get(room_id);
+    struct member *m = r ? member_new(fd) : NULL;
+    if (!r || !m) {
+        free(m);
+        close(fd);
+        return;
+    }
+
+    if (r->n == r->cap) {
+        int cap = r->cap ? r->cap * 2 : 8;
+        void *p = realloc(r->members, (size_t)cap * sizeof(*r->members));
+        if (!p) {
+            free(m);
+            close(fd);
+            return;
+        }
+        r->members = p;
+        r->cap = cap;
+    }
+
+    m->room = r;
+    m->slot = r->n;
+    r->members[r->n++] = m;
+    if (member_watch_events(m) < 0) return;
+
+    room_send_board(r, m);
+}
+
+// ---------- hub main loop ----------
+
+void room_hub_run(int ctl_fd, int metrics_fd, const struct word_index *ix, int evil) {
+    hub_ix         = ix;
+    hub_evil       = evil;
+    hub_metrics_fd = metrics_fd;
+    srand((unsigned int)(time(NULL) ^ (getpid() << 16)));
+    mm_init(&match_queue);
+    if (lb_init(&leaders) < 0) {
+        perror("lb_init");
+        return;
+    }
+
+    // Every room member, spectator and queued player is an fd here.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, ctl_fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return;
+    }
+    // The metrics listener is tagged with its own address; members never
+    // alias it.
+    static char metrics_tag;
+    if (metrics_fd >= 0) {
+        fcntl(metrics_fd, F_SETFL, fcntl(metrics_fd, F_GETFL) | O_NONBLOCK);
+        struct epoll_event mev = { .events = EPOLLIN, .data.ptr = &metrics_tag };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, metrics_fd, &mev) < 0) {
+            perror("epoll_ctl metrics");
+            return;
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    for (;;) {
+        // Tick while players wait so their search windows keep widening,
+        // and while tournaments run so standings go out on time.
+        int timeout = (match_queue.waiting || tourneys) ? 100 : -1;
+        int n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return;
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct member *m = events[i].data.ptr;
+
+            if (events[i].data.ptr == &metrics_tag) {
+                if (hub_metrics_fd >= 0) metrics_accept(hub_metrics_fd);
+                continue;
+            }
+            if (!m) {
+                struct hub_msg msg;
+                ssize_t len;
+                int fd;
+                while ((fd = recv_hub_msg(ctl_fd, &msg, &len)) != -1) {
+                    handle_hub_msg(&msg, len, fd);
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("recvmsg");
+                    return;
+                }
+                continue;
+            }
+
+            if (m->fd >= 0 && (events[i].events & EPOLLOUT)) {
+                member_flush(m);
+            }
+            if (m->fd >= 0 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                member_read(m);
+            }
+        }
+
+        if (match_queue.waiting) {
+            mm_tick(&match_queue, now_ns(), race_matched, NULL);
+        }
+        if (tourneys) {
+            tourney_tick(now_ns());
+        }
+        release_dead();
+    }
+}
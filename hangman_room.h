@@ -0,0 +1,84 @@
+#ifndef HANGMAN_ROOM_H
+#define HANGMAN_ROOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_index.h"
+
+// Rooms: many connections guessing the same secret word together.
+//
+// Forked children cannot share a game, so every room connection lives in
+// one event-loop process, the hub, forked by the parent at startup. A
+// child that reads a "join room" start command passes its socket to the
+// hub over a Unix datagram socket (SCM_RIGHTS) and exits.
+//
+// Each accepted guess is encoded once into a refcounted buffer in the
+// send_game_state layout; that same buffer is queued on every member.
+
+// Spectators attach read-only to a room or a solo session by id and get
+// every frame from then on. Each has a small bounded queue: when it is
+// full a new board replaces everything not yet sent (skip to latest) and
+// messages are dropped, so a slow spectator never slows a player down.
+// Solo sessions (id = the child's pid) publish frames to the hub with
+// non-blocking datagrams, and only while a shared-memory watch count
+// says someone is listening.
+
+#define FEED_ROOM     'R'
+#define FEED_SESSION  'S'
+
+// Parent, before forking the hub: map the shared watch counts. They live
+// in a memfd so a hot upgrade can pass them on with the hub; a new server
+// taking over the hub maps the old one's map_fd, anyone else passes -1.
+// 0 on success, -1 on error.
+int hub_setup(int map_fd);
+
+// Parent: the memfd behind the watch counts, for a hot upgrade.
+int hub_map_fd(void);
+
+// Child side: hand client_fd (welcome sent, start frame consumed) to the
+// hub for room_id. 0 on success, -1 on error.
+int room_handoff(int hub_fd, uint32_t room_id, int client_fd);
+
+// Child side: attach client_fd as a spectator of (kind, id).
+int hub_watch(int hub_fd, int kind, uint32_t id, int client_fd);
+
+// Child side: queue client_fd for a head-to-head race (see hangman_match.h).
+int hub_match(int hub_fd, int rating, int client_fd);
+
+// Child side: enter client_fd in tournament tourney_id, starting it if
+// none is running (see hangman_tourney.h).
+int hub_tourney(int hub_fd, uint32_t tourney_id, int client_fd);
+
+// Child side: answer client_fd with hub statistics (solo game counters,
+// match queue and match-wait histogram) as text messages.
+int hub_stats(int hub_fd, int client_fd);
+
+// Child side: answer client_fd with name's leaderboard rank and record
+// (see hangman_leader.h) as text messages.
+int hub_rank(int hub_fd, const char *name, int client_fd);
+
+// Child side: record a finished solo game for a named player. Never
+// blocks; the result is lost if the hub is behind.
+void hub_result(int hub_fd, const char *name, int won, int misses, uint64_t solve_ns);
+
+// Child side: is anyone watching this solo session?
+int hub_session_watched(uint32_t session_id);
+
+// Child side: copy a frame sent to the player to the session's spectators.
+// Never blocks; the frame is lost if the hub is behind.
+void hub_publish(int hub_fd, uint32_t session_id, const unsigned char *frame, size_t len);
+
+// Child side: the session is over; its spectators are closed.
+void hub_session_end(int hub_fd, uint32_t session_id);
+
+// Parent side: the server is draining. The hub closes its metrics
+// listener, so health probes on it are refused; rooms play on.
+void hub_drain(int hub_fd);
+
+// Hub side: serve rooms until the control socket fails. If metrics_fd is
+// a listening socket (else -1), also answer scrapes on it with the
+// Prometheus text in hangman_metrics.h.
+void room_hub_run(int ctl_fd, int metrics_fd, const struct word_index *ix, int evil);
+
+#endif
@@ -0,0 +1,249 @@
+#define _GNU_SOURCE     // SCHED_IDLE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hangman_stats.h"
+
+// Per-guess round trip over loopback TCP and over a Unix socket, against
+// one server started with --unix:
+//
+//   hangman_rtt <tcp_port> <unix_path> [guesses]
+//
+// Each run starts a v1 game, guesses 'e' once, then guesses 'e' again
+// and again. A repeated letter changes nothing, so every reply is the same
+// board and the game never ends; only the transport differs between runs.
+//
+//   hangman_rtt --heavy <n> <tcp_port> [guesses]
+//
+// The same measurement over TCP while n other connections each keep
+// RTT_HEAVY_DEPTH guesses in flight as fast as the server answers: what a
+// light player sees next to a few heavy ones (--workers 1 puts them all
+// on one worker).
+
+#define RTT_DEFAULT_GUESSES 20000
+#define RTT_HEAVY_DEPTH     64
+#define RTT_HEAVY_MAX       64
+
+static int recv_all(int fd, void *buf, size_t len) {
+    unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, 0);
+        if (n < 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Read one v1 packet; returns its length, or -1.
+static int recv_packet(int fd, unsigned char *buf) {
+    if (recv_all(fd, buf, 1) < 0) return -1;
+    if (buf[0] > 0) return recv_all(fd, buf + 1, buf[0]) < 0 ? -1 : 1 + buf[0];
+    if (recv_all(fd, buf + 1, 2) < 0) return -1;
+    size_t rest = (size_t)buf[1] + buf[2];
+    return recv_all(fd, buf + 3, rest) < 0 ? -1 : (int)(3 + rest);
+}
+
+static int connect_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static int connect_unix(const char *path) {
+    struct sockaddr_un un;
+    memset(&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(un.sun_path)) return -1;
+    strcpy(un.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&un, sizeof(un)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Play the repeated-guess game on fd; fills rtt[0..n). 0 or -1.
+static int measure(int fd, uint64_t *rtt, long n) {
+    unsigned char pkt[512];
+    unsigned char start = 0, guess[2] = { 1, 'e' };
+
+    if (recv_packet(fd, pkt) < 0 || pkt[0] == 0) return -1;       // welcome
+    if (send_all(fd, &start, 1) < 0 || recv_packet(fd, pkt) < 0) return -1;
+    if (send_all(fd, guess, 2) < 0 || recv_packet(fd, pkt) < 0) return -1;
+
+    for (long i = 0; i < n; i++) {
+        uint64_t t0 = now_ns();
+        if (send_all(fd, guess, 2) < 0 || recv_packet(fd, pkt) < 0) return -1;
+        rtt[i] = now_ns() - t0;
+        if (pkt[0] != 0) return -1;     // not a board: the game ended
+    }
+    return 0;
+}
+
+// Heavy connection: keep RTT_HEAVY_DEPTH guesses in flight until killed.
+static void hammer(int fd) {
+    unsigned char pkt[512];
+    unsigned char start = 0, guess[2] = { 1, 'e' }, burst[2 * RTT_HEAVY_DEPTH];
+    for (int i = 0; i < RTT_HEAVY_DEPTH; i++) memcpy(burst + 2 * i, guess, 2);
+
+    if (recv_packet(fd, pkt) < 0 || send_all(fd, &start, 1) < 0 ||
+        recv_packet(fd, pkt) < 0 || send_all(fd, burst, sizeof(burst)) < 0) {
+        return;
+    }
+    while (recv_packet(fd, pkt) >= 0 && pkt[0] == 0 && send_all(fd, guess, 2) >= 0) {
+    }
+}
+
+static void report(const char *name, uint64_t *rtt, long n) {
+    double sum = 0;
+    for (long i = 0; i < n; i++) sum += (double)rtt[i];
+    qsort(rtt, (size_t)n, sizeof(*rtt), cmp_u64);
+    printf("%-10s %8ld guesses  mean %7.2f us  p50 %7.2f us  p99 %7.2f us  min %7.2f us\n",
+           name, n, sum / (double)n / 1000.0, (double)rtt[n / 2] / 1000.0,
+           (double)rtt[n * 99 / 100] / 1000.0, (double)rtt[0] / 1000.0);
+}
+
+static int heavy_main(int argc, char *argv[]) {
+    int heavy = atoi(argv[2]), port = atoi(argv[3]);
+    long n = argc > 4 ? atol(argv[4]) : RTT_DEFAULT_GUESSES;
+    if (n < 1) n = 1;
+    if (heavy < 0 || heavy > RTT_HEAVY_MAX) {
+        fprintf(stderr, "at most %d heavy connections\n", RTT_HEAVY_MAX);
+        return 1;
+    }
+    uint64_t *rtt = malloc((size_t)n * sizeof(*rtt));
+    if (!rtt) {
+        perror("malloc");
+        return 1;
+    }
+
+    pid_t pids[RTT_HEAVY_MAX];
+    for (int i = 0; i < heavy; i++) {
+        int fd = connect_tcp(port);
+        if (fd < 0) {
+            perror("heavy connect");
+            heavy = i;
+            break;
+        }
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            perror("fork");
+            close(fd);
+            heavy = i;
+            break;
+        }
+        if (pids[i] == 0) {
+            // Idle priority: on a machine with few CPUs the heavy clients
+            // would otherwise be what the light one waits for.
+            struct sched_param sp = { .sched_priority = 0 };
+            (void)sched_setscheduler(0, SCHED_IDLE, &sp);
+            hammer(fd);
+            _exit(0);
+        }
+        close(fd);
+    }
+    // Let the heavy connections get going.
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 200 * 1000000L };
+    nanosleep(&ts, NULL);
+
+    int rc = 0;
+    char name[32];
+    snprintf(name, sizeof(name), "tcp+%d", heavy);
+    int fd = connect_tcp(port);
+    if (fd < 0) {
+        perror("tcp");
+        rc = 1;
+    } else if (measure(fd, rtt, n) < 0) {
+        fprintf(stderr, "%s: game ended or connection failed\n", name);
+        rc = 1;
+    } else {
+        report(name, rtt, n);
+    }
+    if (fd >= 0) close(fd);
+    for (int i = 0; i < heavy; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+    }
+    free(rtt);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 4 && argc <= 5 && strcmp(argv[1], "--heavy") == 0) {
+        return heavy_main(argc, argv);
+    }
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s <tcp_port> <unix_path> [guesses]\n"
+                        "       %s --heavy <n> <tcp_port> [guesses]\n", argv[0], argv[0]);
+        return 1;
+    }
+    long n = argc > 3 ? atol(argv[3]) : RTT_DEFAULT_GUESSES;
+    if (n < 1) n = 1;
+    uint64_t *rtt = malloc((size_t)n * sizeof(*rtt));
+    if (!rtt) {
+        perror("malloc");
+        return 1;
+    }
+
+    int rc = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        const char *name = pass == 0 ? "tcp" : "unix";
+        int fd = pass == 0 ? connect_tcp(atoi(argv[1])) : connect_unix(argv[2]);
+        if (fd < 0) {
+            perror(name);
+            rc = 1;
+            continue;
+        }
+        if (measure(fd, rtt, n) < 0) {
+            fprintf(stderr, "%s: game ended or connection failed\n", name);
+            rc = 1;
+        } else {
+            report(name, rtt, n);
+        }
+        close(fd);
+    }
+    free(rtt);
+    return rc;
+}
@@ -0,0 +1,301 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_dict.h"
+#include "hangman_cand.h"
+#include "hangman_game.h"
+
+// Offline difficulty scorer. Plays the hint solver (most-likely-to-hit
+// letter, same as the server's hint frame) against every dictionary word
+// under the server's rules: all occurrences revealed at once, game lost
+// at MAX_INCORRECT misses.
+//
+// The solver is deterministic, so words that have produced the same board
+// so far are still on the same path. Instead of replaying each word we
+// walk the solver's decision tree: a task is a family of words sharing a
+// board, the next letter splits it by reveal mask, and each child family
+// becomes a new task. Every word is touched once per guess it needs.
+// Tasks are spread over a work-stealing pool.
+//
+// Output: <words_file>.meta, one "word<TAB>misses" line per loaded word in
+// dictionary order. misses == MAX_INCORRECT means the solver lost.
+
+// Families smaller than this are finished on the spot instead of queued.
+#define INLINE_CUTOFF 256
+
+struct task {
+    uint32_t *ws;        // word indices, a subrange of family_words
+    uint32_t  n;
+    uint32_t  guessed;
+    uint8_t   misses;
+};
+
+// Owner pushes and pops at the tail; thieves take from the head.
+struct deque {
+    pthread_mutex_t lock;
+    struct task    *buf;
+    size_t          head, tail, cap;
+};
+
+struct worker {
+    int           id;
+    pthread_t     thread;
+    struct deque  dq;
+    uint64_t     *keys;     // scratch for partitioning, num_words long
+    unsigned int  rng;
+    uint64_t      tasks_run;
+    uint64_t      steals;
+};
+
+static struct worker *workers;
+static int            num_workers;
+static long           pending;      // tasks queued or running
+static uint8_t       *score;        // misses per word
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ---------- work-stealing deques ----------
+
+static void dq_push(struct deque *dq, struct task t) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail == dq->cap) {
+        size_t live = dq->tail - dq->head;
+        if (dq->head > 0 && live < dq->cap / 2) {
+            memmove(dq->buf, dq->buf + dq->head, live * sizeof(*dq->buf));
+        } else {
+            dq->cap = dq->cap ? dq->cap * 2 : 64;
+            dq->buf = realloc(dq->buf, dq->cap * sizeof(*dq->buf));
+            if (!dq->buf) {
+                perror("realloc deque");
+                exit(1);
+            }
+            memmove(dq->buf, dq->buf + dq->head, live * sizeof(*dq->buf));
+        }
+        dq->head = 0;
+        dq->tail = live;
+    }
+    dq->buf[dq->tail++] = t;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+static int dq_pop(struct deque *dq, struct task *t) {
+    int ok = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail > dq->head) {
+        *t = dq->buf[--dq->tail];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+static int dq_steal(struct deque *dq, struct task *t) {
+    int ok = 0;
+    if (pthread_mutex_trylock(&dq->lock) != 0) return 0;
+    if (dq->tail > dq->head) {
+        *t = dq->buf[dq->head++];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return ok;
+}
+
+static void submit(struct worker *self, struct task t) {
+    __atomic_add_fetch(&pending, 1, __ATOMIC_RELAXED);
+    dq_push(&self->dq, t);
+}
+
+// ---------- solver ----------
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_task(struct worker *self, struct task t) {
+    self->tasks_run++;
+
+    if (t.misses >= MAX_INCORRECT) {
+        for (uint32_t i = 0; i < t.n; i++) score[t.ws[i]] = MAX_INCORRECT;
+        return;
+    }
+
+    // Words with every letter guessed are solved; the rest keep playing.
+    uint32_t letter_count[26] = {0};
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < t.n; i++) {
+        uint32_t w = t.ws[i];
+        if ((word_letters[w] & ~t.guessed) == 0) {
+            score[w] = t.misses;
+            continue;
+        }
+        for (uint32_t m = word_letters[w]; m; m &= m - 1) {
+            letter_count[__builtin_ctz(m)]++;
+        }
+        t.ws[live++] = w;
+    }
+    if (live == 0) return;
+
+    int c = best_letter(letter_count, t.guessed);
+    uint32_t guessed = t.guessed | (1u << c);
+
+    // Group the family by where c lands: sort (mask, word) pairs.
+    for (uint32_t i = 0; i < live; i++) {
+        uint32_t w = t.ws[i];
+        self->keys[i] = ((uint64_t)letter_pos[w][c] << 32) | w;
+    }
+    qsort(self->keys, live, sizeof(uint64_t), cmp_u64);
+    for (uint32_t i = 0; i < live; i++) {
+        t.ws[i] = (uint32_t)self->keys[i];
+    }
+
+    uint32_t start = 0;
+    while (start < live) {
+        uint16_t mask = (uint16_t)(self->keys[start] >> 32);
+        uint32_t end = start + 1;
+        while (end < live && (uint16_t)(self->keys[end] >> 32) == mask) end++;
+
+        struct task child = {
+            .ws      = t.ws + start,
+            .n       = end - start,
+            .guessed = guessed,
+            .misses  = (uint8_t)(t.misses + (mask == 0)),
+        };
+        if (child.n < INLINE_CUTOFF) {
+            run_task(self, child);
+        } else {
+            submit(self, child);
+        }
+        start = end;
+    }
+}
+
+static void *worker_main(void *arg) {
+    struct worker *self = arg;
+    struct task t;
+
+    for (;;) {
+        int got = dq_pop(&self->dq, &t);
+        for (int tries = 0; !got && tries < num_workers; tries++) {
+            int victim = (int)(rand_r(&self->rng) % (unsigned)num_workers);
+            if (victim != self->id && dq_steal(&workers[victim].dq, &t)) {
+                got = 1;
+                self->steals++;
+            }
+        }
+
+        if (got) {
+            run_task(self, t);
+            __atomic_sub_fetch(&pending, 1, __ATOMIC_RELEASE);
+        } else if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) == 0) {
+            return NULL;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// ---------- main ----------
+
+int main(int argc, char *argv[]) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [words_file] [threads]\n", argv[0]);
+        return 1;
+    }
+    const char *dict = argc > 1 ? argv[1] : "hangman_words.txt";
+    num_workers = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers < 1) num_workers = 1;
+
+    load_words(dict);
+
+    double t0 = now_sec();
+
+    // One root family per word length, laid out contiguously.
+    uint32_t *family_words = malloc((size_t)num_words * sizeof(uint32_t));
+    score   = malloc((size_t)num_words);
+    workers = calloc((size_t)num_workers, sizeof(*workers));
+    if (!family_words || !score || !workers) {
+        perror("malloc");
+        return 1;
+    }
+
+    uint32_t len_start[MAX_WORD_LEN + 2] = {0};
+    for (int w = 0; w < num_words; w++) len_start[strlen(words[w]) + 1]++;
+    for (int l = 1; l <= MAX_WORD_LEN + 1; l++) len_start[l] += len_start[l - 1];
+    uint32_t fill[MAX_WORD_LEN + 1];
+    memcpy(fill, len_start, sizeof(fill));
+    for (int w = 0; w < num_words; w++) family_words[fill[strlen(words[w])]++] = (uint32_t)w;
+
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].id  = i;
+        workers[i].rng = (unsigned int)i * 2654435761u + 1;
+        workers[i].keys = malloc((size_t)num_words * sizeof(uint64_t));
+        if (!workers[i].keys) {
+            perror("malloc");
+            return 1;
+        }
+        pthread_mutex_init(&workers[i].dq.lock, NULL);
+    }
+
+    // Deal the root families round-robin; stealing evens out the rest.
+    for (int l = 1, k = 0; l <= MAX_WORD_LEN; l++) {
+        uint32_t n = len_start[l + 1] - len_start[l];
+        if (n == 0) continue;
+        struct task root = { .ws = family_words + len_start[l], .n = n };
+        submit(&workers[k++ % num_workers], root);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    uint64_t tasks = 0, steals = 0;
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        tasks  += workers[i].tasks_run;
+        steals += workers[i].steals;
+    }
+    double elapsed = now_sec() - t0;
+
+    // Write the metadata file next to the dictionary.
+    char meta_path[4096];
+    snprintf(meta_path, sizeof(meta_path), "%s.meta", dict);
+    FILE *out = fopen(meta_path, "w");
+    if (!out) {
+        perror(meta_path);
+        return 1;
+    }
+    uint64_t hist[MAX_INCORRECT + 1] = {0};
+    for (int w = 0; w < num_words; w++) {
+        fprintf(out, "%s\t%u\n", words[w], score[w]);
+        hist[score[w]]++;
+    }
+    if (fclose(out) != 0) {
+        perror(meta_path);
+        return 1;
+    }
+
+    printf("scored %d words with %d threads in %.3f s (%.0f words/s)\n",
+           num_words, num_workers, elapsed, (double)num_words / elapsed);
+    printf("tasks %llu, steals %llu\n",
+           (unsigned long long)tasks, (unsigned long long)steals);
+    for (int m = 0; m <= MAX_INCORRECT; m++) {
+        printf("%s %d: %llu\n", m == MAX_INCORRECT ? "lost  " : "misses", m,
+               (unsigned long long)hist[m]);
+    }
+    printf("wrote %s\n", meta_path);
+    return 0;
+}
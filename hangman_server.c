@@ -1,8 +1,16 @@
+#define _GNU_SOURCE     // ppoll
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/pidfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,14 +19,86 @@
 #include <time.h>
 #include <ctype.h>
 
+#include "hangman_dict.h"
+#include "hangman_index.h"
+#include "hangman_cand.h"
+#include "hangman_game.h"
+#include "hangman_proto.h"
+#include "hangman_room.h"
+#include "hangman_match.h"
+#include "hangman_leader.h"
+#include "hangman_stats.h"
+#include "hangman_trace.h"
+#include "hangman_log.h"
+#include "hangman_flight.h"
+#include "hangman_capture.h"
+#include "hangman_udp.h"
+#include "hangman_worker.h"
+#include "hangman_upgrade.h"
+#include "hangman_sesstab.h"
+
 #define MAX_CLIENTS   3
 #define BACKLOG       16
-#define MAX_WORDS     1024
-#define MAX_WORD_LEN  16   // per spec
-#define MAX_INCORRECT 8
 
-static char words[MAX_WORDS][MAX_WORD_LEN + 1]; // +1 for '\0'
-static int  num_words = 0;
+static int evil_mode = 0;
+
+// --replay: honour START_REPLAY, letting the client pick the word.
+static int replay_mode = 0;
+
+static struct word_index dict_index;
+
+// Children hand room joins to the hub process through this socket.
+static int   hub_fd  = -1;
+static pid_t hub_pid = -1;
+
+// Solo session id (the child's pid) that spectators attach to; 0 in the parent.
+static uint32_t session_id = 0;
+
+// Parent: which child owns each stats slot (0 = free). Slot 0 is the
+// parent's own; the UDP process, if any, takes the last one.
+static pid_t stats_owner[STATS_SLOTS];
+
+// The UDP game process (--udp), or -1.
+static pid_t udp_pid = -1;
+
+// Parent, after a hot upgrade: the hub and the UDP process are the old
+// server's children, taken over with their games rather than forked anew.
+// reap_children never sees them exit, so the accept loop watches them
+// through pidfds instead (-1 when not adopted).
+static int hub_adopted = 0, udp_adopted = 0;
+static int hub_pidfd = -1, udp_pidfd = -1;
+
+// --workers: games run on this many threads instead of a child each.
+static int n_workers = 0;
+
+// Parent: SIGTERM asks for a drain, SIGUSR2 for a hot upgrade. Both stay
+// blocked except while waiting for a client, when accept_mask is in force.
+static volatile sig_atomic_t draining = 0;
+static volatile sig_atomic_t upgrade_wanted = 0;
+static sigset_t accept_mask;
+
+// Parent: the listening sockets, kept open so a hot upgrade can pass them
+// on; -1 when not in use.
+static int lsock = -1, usock = -1, metrics_fd = -1, udp_fd = -1;
+
+// Parent: the channel to the other server while a hot upgrade is under
+// way (-1 otherwise), that server's pid, and whether we are the new one.
+static int   up_fd  = -1;
+static pid_t up_pid = -1;
+static int   taking_over = 0;
+static int   resumed = 0;
+
+// Parent, after a hot upgrade: stats slots the old server's children or
+// workers may still be writing.
+static pid_t slot_inherited[STATS_SLOTS];
+
+// Child: bytes sent to the player this game.
+static uint64_t bytes_sent = 0;
+
+// Child: the player negotiated protocol v2 in the start frame, with
+// these V2_F_* features.
+static int     proto_v2    = 0;
+static uint8_t v2_features = 0;
 
 // ---------- utilities ----------
 
@@ -49,60 +129,82 @@ static int send_all(int fd, const char *buf, size_t len) {
     return 0;
 }
 
-// load word list from hangman_words.txt
-static void load_words(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) {
-        perror("fopen hangman_words.txt");
-        exit(1);
+// Mirror one v1 frame to spectators, if the session has any.
+static void mirror_frame(const unsigned char *pkt, size_t len) {
+    if (session_id && hub_session_watched(session_id)) {
+        hub_publish(hub_fd, session_id, pkt, len);
     }
+}
 
-    char line[256];
-    while (num_words < MAX_WORDS && fgets(line, sizeof(line), f)) {
-        // strip newline
-        char *p = line;
-        while (*p && *p != '\n' && *p != '\r') p++;
-        *p = '\0';
-
-        size_t len = strlen(line);
-        if (len == 0) continue;
-        if (len > MAX_WORD_LEN) continue;
-
-        int ok = 1;
-        for (size_t i = 0; i < len; i++) {
-            if (!isalpha((unsigned char)line[i])) {
-                ok = 0;
-                break;
-            }
-        }
-        if (!ok) continue;
-
-        // store lowercase version
-        for (size_t i = 0; i < len; i++) {
-            words[num_words][i] = (char)tolower((unsigned char)line[i]);
-        }
-        words[num_words][len] = '\0';
-        num_words++;
-    }
+// Send one encoded frame to the player only.
+static int send_player(int fd, const unsigned char *pkt, size_t len) {
+    bytes_sent += len;
+    fr_record(FR_SENT, pkt, len);
+    cap_frame(CAP_OUT, pkt, len);
+    return send_all(fd, (const char *)pkt, len);
+}
 
-    fclose(f);
+// The resume token goes to the player alone: a spectator holding it could
+// take the game over, and a replayed trace has no token to compare.
+static int send_token(int fd, uint64_t token) {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "Resume token: %016llx", (unsigned long long)token);
+    unsigned char pkt[V2_TEXT_MAX];
+    size_t len = proto_v2 ? v2_encode_text(pkt, msg, strlen(msg)) : encode_message(pkt, msg);
+    bytes_sent += len;
+    fr_record(FR_SENT, pkt, len);
+    return send_all(fd, (const char *)pkt, len);
+}
 
-    if (num_words == 0) {
-        fprintf(stderr, "No valid words loaded from %s\n", filename);
-        exit(1);
-    }
+// Send one encoded v1 frame to the player and mirror it to spectators.
+static int send_frame(int fd, const unsigned char *pkt, size_t len) {
+    mirror_frame(pkt, len);
+    return send_player(fd, pkt, len);
 }
 
 // Send a message packet: msg_flag = length, then that many bytes.
+// v2 players get a V2_TEXT frame; spectators always get v1.
 static int send_message_packet(int fd, const char *msg) {
+    // header and body in one send so they leave in one segment
+    unsigned char pkt[MESSAGE_PKT_MAX];
+    if (!proto_v2) {
+        size_t len = encode_message(pkt, msg);
+        return send_frame(fd, pkt, len);
+    }
+    if (session_id && hub_session_watched(session_id)) {
+        mirror_frame(pkt, encode_message(pkt, msg));
+    }
+    unsigned char v2[V2_TEXT_MAX];
     size_t len = strlen(msg);
-    if (len > 255) len = 255;  // protocol uses 1-byte length
+    return send_player(fd, v2, v2_encode_text(v2, msg, len < MSG_MAX ? len : MSG_MAX));
+}
 
-    unsigned char header = (unsigned char)len;
-    if (send_all(fd, (char *)&header, 1) < 0) return -1;
-    if (len > 0 && send_all(fd, msg, len) < 0) return -1;
+// End a connection that never got a game: "Game Over!", or the
+// GAME_OVER status for v2.
+static int send_game_over(int fd) {
+    if (!proto_v2) {
+        return send_message_packet(fd, "Game Over!");
+    }
+    unsigned char v2[V2_STATUS_MAX];
+    return send_player(fd, v2, v2_encode_status(v2, V2_ST_GAME_OVER));
+}
 
-    return 0;
+// Answer a hint request: best is the letter, or 0 for none left.
+static int send_hint(int fd, int best) {
+    char hint_msg[] = "Hint: none";
+    if (best > 0) {
+        hint_msg[6] = (char)best;
+        hint_msg[7] = '\0';
+    }
+    if (!proto_v2) {
+        return send_message_packet(fd, hint_msg);
+    }
+    if (session_id && hub_session_watched(session_id)) {
+        unsigned char pkt[MESSAGE_PKT_MAX];
+        mirror_frame(pkt, encode_message(pkt, hint_msg));
+    }
+    unsigned char v2[V2_HINT_MAX];
+    return send_player(fd, v2, v2_encode_hint(v2, best));
 }
 
 // Send current game-control state for this client:
@@ -112,37 +214,59 @@ static int send_message_packet(int fd, const char *msg) {
 // [2] = num_incorrect
 // then: word_len bytes of masked word
 // then: num_incorrect bytes of incorrect letters
-static int send_game_state(int client_fd,
-                           const char *masked,
-                           const unsigned char *incorrect,
-                           unsigned char word_len,
-                           unsigned char num_incorrect)
-{
-    if (word_len == 0 || word_len > MAX_WORD_LEN) return -1;
-
-    unsigned char header[3];
-    header[0] = 0;              // msg_flag = 0 => game-control
-    header[1] = word_len;
-    header[2] = num_incorrect;
-
-    unsigned char data[MAX_WORD_LEN + MAX_WORD_LEN]; // 8 + 8 max
-    if ((int)word_len + (int)num_incorrect > (int)sizeof(data)) {
-        return -1;
+static int send_game_state(int client_fd, const struct game *g) {
+    unsigned char pkt[GAME_STATE_MAX];
+    if (!proto_v2) {
+        size_t len = encode_game_state(pkt, g->masked, g->incorrect,
+                                       g->word_len, g->num_incorrect);
+        if (len == 0) return -1;
+        return send_frame(client_fd, pkt, len);
+    }
+    if (session_id && hub_session_watched(session_id)) {
+        mirror_frame(pkt, encode_game_state(pkt, g->masked, g->incorrect,
+                                            g->word_len, g->num_incorrect));
     }
+    unsigned char v2[V2_BOARD_MAX];
+    size_t len = v2_encode_board(v2, g->masked, g->incorrect,
+                                 g->word_len, g->num_incorrect);
+    if (len == 0) return -1;
+    return send_player(client_fd, v2, len);
+}
 
-    // copy masked
-    for (unsigned char i = 0; i < word_len; i++) {
-        data[i] = (unsigned char)masked[i];
+// Send the board after a guess of letter. Delta players get only what
+// changed; everyone else (and spectators) the whole board.
+static int send_guess_state(int client_fd, const struct game *g,
+                            unsigned char letter, enum guess_result res)
+{
+    if (!proto_v2 || !(v2_features & V2_F_DELTA)) {
+        return send_game_state(client_fd, g);
     }
-    // copy incorrect
-    for (unsigned char j = 0; j < num_incorrect; j++) {
-        data[word_len + j] = incorrect[j];
+    if (session_id && hub_session_watched(session_id)) {
+        unsigned char pkt[GAME_STATE_MAX];
+        mirror_frame(pkt, encode_game_state(pkt, g->masked, g->incorrect,
+                                            g->word_len, g->num_incorrect));
     }
+    unsigned char v2[V2_DELTA_MAX];
+    size_t len = res == GUESS_MISS ? v2_encode_miss(v2, letter)
+               : v2_encode_reveal(v2, letter, res == GUESS_HIT ? game_reveal_mask(g, letter) : 0);
+    return send_player(client_fd, v2, len);
+}
 
-    if (send_all(client_fd, (char *)header, sizeof(header)) < 0) return -1;
-    if (send_all(client_fd, (char *)data, word_len + num_incorrect) < 0) return -1;
-
-    return 0;
+// Send the end-of-game frames in one write; returns the bytes sent to
+// the player, or 0 on error.
+static size_t send_game_end(int client_fd, const struct game *g) {
+    unsigned char end[GAME_END_MAX];
+    size_t len;
+    if (!proto_v2) {
+        len = encode_game_end(end, game_secret(g), game_won(g));
+        return send_frame(client_fd, end, len) < 0 ? 0 : len;
+    }
+    if (session_id && hub_session_watched(session_id)) {
+        mirror_frame(end, encode_game_end(end, game_secret(g), game_won(g)));
+    }
+    unsigned char v2[V2_GAME_END_MAX];
+    len = v2_encode_game_end(v2, game_secret(g), game_won(g));
+    return send_player(client_fd, v2, len) < 0 ? 0 : len;
 }
 
 // ---------- per-client handler (child) ----------
@@ -150,44 +274,205 @@ static int send_game_state(int client_fd,
 static void handle_client(int client_fd) {
     ssize_t n;
     uint8_t msg_len;
+    char player[LB_NAME_MAX + 1] = "";    // leaderboard name, "" = not recorded
+
+    // Every frame is a tiny request/response; don't let Nagle hold the
+    // end-of-game messages back waiting for a delayed ACK.
+    int one = 1;
+    (void)setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
     // 0) Send a welcome message packet immediately.
     //    Client prints this as ">>>Welcome to Hangman"
     if (send_message_packet(client_fd, "Welcome to Hangman") < 0) {
         return;
     }
+    uint64_t welcome_at = stats_clock();
 
-    // 1) Read the one-byte "start game" header from client (msg_len=0).
+    // 1) Read the "start game" frame from client. Legacy clients send an
+    //    empty one (msg_len=0); a non-empty one carries a start command.
     n = recv(client_fd, &msg_len, 1, 0);
     if (n <= 0) {
         // client closed or error before starting
         return;
     }
+    char frame[1 + MSG_MAX + 1];
+    char *cmd = frame + 1;
+    if (msg_len > 0 && recv_all(client_fd, cmd, msg_len) < 0) {
+        return;
+    }
+    frame[0] = (char)msg_len;
+    cmd[msg_len] = '\0';
+    fr_record(FR_START, cmd, msg_len);
+    cap_frame(CAP_IN, frame, 1 + (size_t)msg_len);
+
+    if (msg_len > 0 && cmd[0] == START_V2) {
+        // v2 framing for everything we send from here on; the rest of
+        // the frame (after the features byte) is the real start command.
+        proto_v2 = 1;
+        v2_features = msg_len > 1 ? (uint8_t)cmd[1] : 0;
+        size_t skip = msg_len > 1 ? 2 : 1;
+        cmd     += skip;
+        msg_len -= (uint8_t)skip;
+    }
+    stats_record(HIST_START, stats_clock() - welcome_at);
+    TRACE3(start, session_id, msg_len, msg_len ? cmd[0] : 0);
+
+    if (proto_v2 && start_for_hub(cmd, msg_len)) {
+        (void)send_message_packet(client_fd, V2_SOLO_ONLY);
+        (void)send_game_over(client_fd);
+        return;
+    }
+
+    if (msg_len > 0) {
+        if (cmd[0] == START_JOIN_ROOM) {
+            // The room hub owns the connection from here on.
+            uint32_t room_id = (uint32_t)strtoul(cmd + 1, NULL, 10);
+            if (room_handoff(hub_fd, room_id, client_fd) < 0) {
+                perror("room_handoff");
+                (void)send_game_over(client_fd);
+            }
+            return;
+        }
+
+        if (cmd[0] == START_MATCH) {
+            int rating = msg_len > 1 ? atoi(cmd + 1) : MM_DEFAULT_RATING;
+            if (hub_match(hub_fd, rating, client_fd) < 0) {
+                perror("hub_match");
+                (void)send_game_over(client_fd);
+            }
+            return;
+        }
+
+        if (cmd[0] == START_TOURNEY) {
+            uint32_t id = (uint32_t)strtoul(cmd + 1, NULL, 10);
+            if (hub_tourney(hub_fd, id, client_fd) < 0) {
+                perror("hub_tourney");
+                (void)send_game_over(client_fd);
+            }
+            return;
+        }
+
+        if (cmd[0] == START_RANK) {
+            if (hub_rank(hub_fd, cmd + 1, client_fd) < 0) {
+                perror("hub_rank");
+                (void)send_game_over(client_fd);
+            }
+            return;
+        }
+
+        if (cmd[0] == START_PLAYER) {
+            // A solo game like any other, with the outcome recorded.
+            snprintf(player, sizeof(player), "%.*s", LB_NAME_MAX, cmd + 1);
+        }
+
+        if (cmd[0] == START_STATS) {
+            if (hub_stats(hub_fd, client_fd) < 0) {
+                perror("hub_stats");
+            }
+            return;
+        }
+
+        if (cmd[0] == START_WATCH && (cmd[1] == FEED_ROOM || cmd[1] == FEED_SESSION)) {
+            // Read-only spectator; the hub owns the connection from here on.
+            uint32_t id = (uint32_t)strtoul(cmd + 2, NULL, 10);
+            if (hub_watch(hub_fd, cmd[1], id, client_fd) < 0) {
+                perror("hub_watch");
+                (void)send_game_over(client_fd);
+            }
+            return;
+        }
+    }
 
     // seed RNG uniquely per child
     unsigned int seed = (unsigned int)(time(NULL) ^ (getpid() << 16));
     srand(seed);
 
     // 2) Choose a random word for this client and initialize state.
-    int idx = rand() % num_words;
-    const char *secret = words[idx];
-
-    unsigned char word_len = (unsigned char)strlen(secret);
-
-    char masked[MAX_WORD_LEN];
-    for (unsigned char i = 0; i < word_len; i++) {
-        masked[i] = '_';
+    //    A replayed trace of a resumed game names the state it took up.
+    int word_idx = rand() % num_words;
+    struct session_pack pack;
+    int unpack = 0;
+    memset(&pack, 0, sizeof(pack));
+    if (msg_len > 0 && cmd[0] == START_REPLAY) {
+        long want = strtol(cmd + 1, NULL, 10);
+        if (!replay_mode || want < 0 || want >= num_words) {
+            (void)send_game_over(client_fd);
+            return;
+        }
+        if (replay_differs(cmd, num_words, evil_mode)) {
+            (void)send_message_packet(client_fd, REPLAY_CONFIG_DIFFERS);
+            (void)send_game_over(client_fd);
+            return;
+        }
+        word_idx = (int)want;
+        int misses = replay_resumed(cmd, &pack.guessed, pack.incorrect, MAX_INCORRECT - 1);
+        if (misses < 0) {
+            (void)send_game_over(client_fd);
+            return;
+        }
+        if (pack.guessed) {
+            pack.word_idx      = word_idx;
+            pack.num_incorrect = (unsigned char)misses;
+            pack.evil          = (unsigned char)evil_mode;
+            unpack = 1;
+        }
+    }
+    // On --resume servers "K" makes the game resumable and "K<token>"
+    // carries one on; it lives in the session table from here on.
+    int32_t tab_slot = -1;
+    uint64_t token = 0;
+    struct session sess;
+    if (msg_len > 1 && cmd[0] == START_RESUME) {
+        token    = strtoull(cmd + 1, NULL, 16);
+        tab_slot = sesstab_enabled() ? sesstab_adopt(token, &pack) : -1;
+        if (tab_slot < 0) {
+            (void)send_message_packet(client_fd, "No game to resume");
+            (void)send_game_over(client_fd);
+            return;
+        }
+        unpack = 1;
+    }
+    if (unpack) {
+        if (session_unpack(&sess, &pack, &dict_index) < 0) {
+            perror("session_unpack");
+            if (tab_slot >= 0) sesstab_release(tab_slot, 1);
+            session_end(&sess);
+            return;
+        }
+    } else {
+        if (session_start(&sess, &dict_index, word_idx, evil_mode) < 0) {
+            perror("session_start");
+            return;
+        }
+        session_pack(&sess, &pack);
+        if (msg_len > 0 && cmd[0] == START_RESUME && sesstab_enabled()) {
+            tab_slot = sesstab_claim(&token);
+            if (tab_slot >= 0) sesstab_save(tab_slot, &sess);
+        }
     }
+    cap_word(&pack, (uint32_t)num_words);
+    struct game *g = &sess.g;
+    int finished = 0;
+    stats_add(STAT_GAMES, 1);
 
-    unsigned char incorrect[MAX_INCORRECT];   // allow up to 8 incorrect
-    unsigned char num_incorrect = 0;
+    if (tab_slot >= 0) {
+        if (send_token(client_fd, token) < 0) {
+            sesstab_release(tab_slot, 1);
+            session_end(&sess);
+            return;
+        }
+    }
 
     // send initial board
-    if (send_game_state(client_fd, masked, incorrect, word_len, num_incorrect) < 0) {
+    if (send_game_state(client_fd, g) < 0) {
         perror("send_game_state");
+        if (tab_slot >= 0) sesstab_release(tab_slot, 1);
+        session_end(&sess);
         return;
     }
 
+    uint64_t start_ns = now_ns();
+
     // 3) Guess loop.
     for (;;) {
         uint8_t guess_len;
@@ -198,18 +483,32 @@ static void handle_client(int client_fd) {
             break;
         }
 
+        if (guess_len == 0) {
+            // Hint request: answer with the letter that best splits the
+            // remaining candidates.
+            stats_add(STAT_HINTS, 1);
+            fr_record(FR_HINT, NULL, 0);
+            cap_frame(CAP_IN, &guess_len, 1);
+            int best = session_hint(&sess, &dict_index);
+            if (best < 0) {
+                perror("session_hint");
+                break;
+            }
+            if (send_hint(client_fd, best) < 0) {
+                break;
+            }
+            continue;
+        }
+
         if (guess_len != 1) {
             // invalid guess packet, drain and ignore
-            char tmp[256];
-            size_t remaining = guess_len;
-            while (remaining > 0) {
-                size_t chunk = remaining < sizeof(tmp) ? remaining : sizeof(tmp);
-                if (recv_all(client_fd, tmp, chunk) < 0) {
-                    remaining = 0;
-                    break;
-                }
-                remaining -= chunk;
+            fr_record(FR_OTHER, NULL, guess_len);
+            unsigned char tmp[1 + 255];
+            tmp[0] = guess_len;
+            if (recv_all(client_fd, tmp + 1, guess_len) < 0) {
+                break;
             }
+            cap_frame(CAP_IN, tmp, 1 + (size_t)guess_len);
             continue;
         }
 
@@ -217,122 +516,229 @@ static void handle_client(int client_fd) {
         if (recv_all(client_fd, &letter, 1) < 0) {
             break;
         }
+        // One clock read serves the flight recorder and the latency histogram.
+        uint64_t guess_at = fr_record(FR_GUESS, &letter, 1);
+        unsigned char guess_frame[2] = { 1, letter };
+        cap_frame(CAP_IN, guess_frame, sizeof(guess_frame));
+        TRACE2(guess, session_id, letter);
 
         letter = (unsigned char)tolower(letter);
+        enum guess_result res = session_guess(&sess, letter);
+        stats_add(STAT_GUESSES, 1);
+        TRACE3(reveal, session_id, (int)res, g->num_incorrect);
 
-        // Check if this letter was already guessed (in masked or incorrect)
-        int already_guessed = 0;
-        for (unsigned char i = 0; i < word_len; i++) {
-            if (masked[i] == (char)letter) {
-                already_guessed = 1;
-                break;
-            }
-        }
-        if (!already_guessed) {
-            for (unsigned char j = 0; j < num_incorrect; j++) {
-                if (incorrect[j] == letter) {
-                    already_guessed = 1;
-                    break;
-                }
-            }
-        }
-
-        if (!already_guessed) {
-            // First time seeing this letter. Check if it's in the secret word.
-            int found = 0;
-            for (unsigned char i = 0; i < word_len; i++) {
-                if ((unsigned char)secret[i] == letter) {
-                    masked[i] = (char)letter;
-                    found = 1;
-                }
-            }
-
-            if (!found) {
-                if (num_incorrect < MAX_INCORRECT) {
-                    incorrect[num_incorrect++] = letter;
-                }
-            }
-        }
-
-        // Check for win
-        int all_revealed = 1;
-        for (unsigned char i = 0; i < word_len; i++) {
-            if (masked[i] == '_') {
-                all_revealed = 0;
-                break;
-            }
-        }
-
-        if (all_revealed) {
-            // send final board one last time if you want (optional),
-            // but spec only cares about the win/lose messages.
-            // Send:
+        if (game_won(g) || game_lost(g)) {
+            // Send, in one write:
             //   "The word was l o o k"
-            //   "You Win!"
+            //   "You Win!" / "You Lose."
             //   "Game Over!"
-            char word_msg[3 * MAX_WORD_LEN + 32];
-            int pos = 0;
-            pos += snprintf(word_msg + pos, sizeof(word_msg) - pos,
-                            "The word was");
-            for (unsigned char i = 0; i < word_len; i++) {
-                pos += snprintf(word_msg + pos, sizeof(word_msg) - pos,
-                                " %c", secret[i]);
+            if (tab_slot >= 0) sesstab_release(tab_slot, 0);
+            size_t len = send_game_end(client_fd, g);
+            TRACE2(board_sent, session_id, len);
+            TRACE2(game_end, session_id, game_won(g));
+            stats_add(game_won(g) ? STAT_WON : STAT_LOST, 1);
+            stats_record(HIST_GUESS, stats_clock() - guess_at);
+            finished = 1;
+            if (player[0]) {
+                hub_result(hub_fd, player, game_won(g), g->num_incorrect,
+                           now_ns() - start_ns);
             }
-            word_msg[sizeof(word_msg) - 1] = '\0';
-
-            (void)send_message_packet(client_fd, word_msg);
-            (void)send_message_packet(client_fd, "You Win!");
-            (void)send_message_packet(client_fd, "Game Over!");
             break;
         }
 
-        // Check for lose (>= 6 incorrect guesses)
-        if (num_incorrect >= MAX_INCORRECT) {
-            char word_msg[3 * MAX_WORD_LEN + 32];
-            int pos = 0;
-            pos += snprintf(word_msg + pos, sizeof(word_msg) - pos,
-                            "The word was");
-            for (unsigned char i = 0; i < word_len; i++) {
-                pos += snprintf(word_msg + pos, sizeof(word_msg) - pos,
-                                " %c", secret[i]);
-            }
-            word_msg[sizeof(word_msg) - 1] = '\0';
-
-            (void)send_message_packet(client_fd, word_msg);
-            (void)send_message_packet(client_fd, "You Lose.");
-            (void)send_message_packet(client_fd, "Game Over!");
-            break;
-        }
-
-        // Otherwise, send updated board
-        if (send_game_state(client_fd, masked, incorrect, word_len, num_incorrect) < 0) {
+        // Otherwise, send updated board; the table has the guess first,
+        // so a crash after the reply never loses one the client saw.
+        if (tab_slot >= 0) sesstab_save(tab_slot, &sess);
+        uint64_t sent_before = bytes_sent;
+        if (send_guess_state(client_fd, g, letter, res) < 0) {
             perror("send_game_state");
             break;
         }
+        TRACE2(board_sent, session_id, bytes_sent - sent_before);
+        stats_record(HIST_GUESS, stats_clock() - guess_at);
     }
+
+    if (!finished) stats_add(STAT_ABANDONED, 1);
+    if (!finished && tab_slot >= 0) sesstab_release(tab_slot, 1);
+    stats_record(HIST_GAME_BYTES, bytes_sent);
+    session_end(&sess);
 }
 
 // ---------- main server loop ----------
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <port>\n", argv[0]);
+// pid was the hub or the UDP process: say so and forget it. Returns 1 if
+// it was one of them.
+static int helper_exited(pid_t pid) {
+    if (pid == hub_pid) {
+        fprintf(stderr, "Room hub exited; rooms unavailable\n");
+        hub_pid = -1;
+        return 1;
+    }
+    if (pid == udp_pid) {
+        fprintf(stderr, "UDP server exited; UDP games unavailable\n");
+        udp_pid = -1;
         return 1;
     }
+    return 0;
+}
 
-    int port = atoi(argv[1]);
+// The adopted hub or UDP process may have exited: its pidfd is readable.
+static void reap_adopted(void) {
+    struct pollfd fds[2] = {
+        { .fd = hub_pidfd, .events = POLLIN },
+        { .fd = udp_pidfd, .events = POLLIN },
+    };
+    if (poll(fds, 2, 0) <= 0) return;
+    if (fds[0].revents) {
+        (void)helper_exited(hub_pid);
+        close(hub_pidfd);
+        hub_pidfd = -1;
+    }
+    if (fds[1].revents) {
+        (void)helper_exited(udp_pid);
+        close(udp_pidfd);
+        udp_pidfd = -1;
+    }
+}
+
+static void reap_children(int *active_clients) {
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        TRACE2(reap, pid, status);
+        if (helper_exited(pid)) continue;
+        for (int i = 1; i < STATS_SLOTS; i++) {
+            if (stats_owner[i] == pid) stats_owner[i] = 0;
+        }
+        if (WIFSIGNALED(status) && sesstab_enabled()) {
+            // A clean exit released its game; a crash left it owned.
+            int n = sesstab_orphan_owner(pid);
+            if (n > 0) log_event(LOG_ORPHANED, pid, n);
+        }
+        if (*active_clients > 0) {
+            (*active_clients)--;
+            stats_set_active((uint64_t)*active_clients);
+            log_event(LOG_EXITED, pid, *active_clients);
+        }
+    }
+}
+
+static uint64_t clock_hz(void) {
+    const struct stats_segment *seg = stats_segment();
+    return seg ? seg->clock_hz : 0;
+}
+
+// Child: close the parent's listeners and upgrade channel, except keep.
+static void close_listeners(int keep) {
+    int fds[] = { lsock, usock, metrics_fd, udp_fd, up_fd, hub_pidfd, udp_pidfd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] >= 0 && fds[i] != keep) close(fds[i]);
+    }
+}
+
+// Parent: is stats slot i free? One the old server handed over stays
+// taken until its writer has exited.
+static int slot_free(int i) {
+    if (stats_owner[i]) return 0;
+    if (slot_inherited[i] && (kill(slot_inherited[i], 0) == 0 || errno != ESRCH)) return 0;
+    slot_inherited[i] = 0;
+    return 1;
+}
+
+// Fork the room hub: one event-loop process that owns every room
+// connection (and serves metrics_fd, if any). Must run after the
+// dictionary and index are loaded. The parent keeps metrics_fd only to
+// pass it on in a hot upgrade.
+static int start_room_hub(void) {
+    int sv[2];
+    if (hub_setup(-1) < 0) {
+        perror("hub_setup");
+        return -1;
+    }
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0) {
+        perror("socketpair");
+        return -1;
+    }
+
+    hub_pid = fork();
+    if (hub_pid < 0) {
+        perror("fork hub");
+        return -1;
+    }
+    if (hub_pid == 0) {
+        close_listeners(metrics_fd);
+        close(sv[1]);
+        signal(SIGUSR2, SIG_IGN);       // meant for the parent
+        stats_use_slot(-1);
+        fr_init(0, clock_hz());
+        room_hub_run(sv[0], metrics_fd, &dict_index, evil_mode);
+        _exit(0);
+    }
+
+    close(sv[0]);
+    hub_fd = sv[1];
+    return 0;
+}
+
+// The UDP game socket (--udp). Returns the fd, or -1.
+static int open_udp_socket(int udp_port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("udp socket");
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(udp_port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("udp bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Fork the UDP game process on udp_fd: every UDP game is served by this
+// one process, which counts into the last stats slot. Forked before the
+// workers start, so it never holds copies of their games' sockets.
+static int start_udp(void) {
+    udp_pid = fork();
+    if (udp_pid < 0) {
+        perror("fork udp");
+        return -1;
+    }
+    if (udp_pid == 0) {
+        close_listeners(udp_fd);
+        close(hub_fd);
+        signal(SIGUSR2, SIG_IGN);       // meant for the parent
+        stats_use_slot(STATS_SLOTS - 1);
+        fr_init(0, clock_hz());
+        udp_run(udp_fd, &dict_index, evil_mode);
+        _exit(0);
+    }
+    stats_owner[STATS_SLOTS - 1] = udp_pid;
+    return 0;
+}
 
-    int lsock = socket(AF_INET, SOCK_STREAM, 0);
-    if (lsock < 0) {
+// The TCP game listener. Non-blocking, like the Unix one: during a hot
+// upgrade two servers wait on the same socket, and the one that loses
+// the race for a connection must not block in accept(). Returns the
+// listening fd, or -1.
+static int open_tcp_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
         perror("socket");
-        return 1;
+        return -1;
     }
 
     int yes = 1;
-    if (setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0) {
         perror("setsockopt");
-        close(lsock);
-        return 1;
+        close(fd);
+        return -1;
     }
 
     struct sockaddr_in addr;
@@ -341,58 +747,542 @@ int main(int argc, char *argv[]) {
     addr.sin_port        = htons(port);
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
 
-    if (bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
         perror("bind");
-        close(lsock);
-        return 1;
+        close(fd);
+        return -1;
     }
 
-    if (listen(lsock, BACKLOG) < 0) {
+    if (listen(fd, BACKLOG) < 0) {
         perror("listen");
-        close(lsock);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Stream listener on a Unix socket path, for frontends on the same host.
+// Returns the listening fd, or -1.
+static int open_unix_listener(const char *path) {
+    struct sockaddr_un un;
+    memset(&un, 0, sizeof(un));
+    un.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(un.sun_path)) {
+        fprintf(stderr, "unix socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(un.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    (void)unlink(path);
+    if (bind(fd, (struct sockaddr *)&un, sizeof(un)) < 0 || listen(fd, BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void on_signal(int sig) {
+    if (sig == SIGTERM) draining = 1;
+    if (sig == SIGUSR2) upgrade_wanted = 1;
+}
+
+// Wait for a client on either listener, for the upgrade channel, or for
+// an adopted hub or UDP process to exit. Returns the client fd, -2 if the
+// channel has something, -3 if an adopted process exited, or -1 (EINTR:
+// a signal). Signals can only land inside ppoll, so a SIGTERM or SIGUSR2
+// cannot slip in between the caller's checks and the wait.
+static int accept_any(void) {
+    struct pollfd fds[5] = {
+        { .fd = lsock, .events = POLLIN },
+        { .fd = usock, .events = POLLIN },
+        { .fd = up_fd, .events = POLLIN },
+        { .fd = hub_pidfd, .events = POLLIN },
+        { .fd = udp_pidfd, .events = POLLIN },
+    };
+    if (ppoll(fds, 5, NULL, &accept_mask) < 0) return -1;
+    if (fds[2].revents) return -2;
+    if (fds[3].revents || fds[4].revents) return -3;
+    // Unix first: those are the co-located frontends. Close-on-exec, so
+    // the exec in a hot upgrade never takes worker games along.
+    return accept4(usock >= 0 && fds[1].revents ? usock : lsock, NULL, NULL, SOCK_CLOEXEC);
+}
+
+// Metrics listener: a TCP port, or a Unix socket path if spec starts
+// with '/'. Returns the listening fd, or -1.
+static int open_metrics_listener(const char *spec) {
+    int fd;
+    if (spec[0] == '/') {
+        struct sockaddr_un un;
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        if (strlen(spec) >= sizeof(un.sun_path)) {
+            fprintf(stderr, "metrics socket path too long: %s\n", spec);
+            return -1;
+        }
+        strcpy(un.sun_path, spec);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        (void)unlink(spec);
+        if (bind(fd, (struct sockaddr *)&un, sizeof(un)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in in;
+        memset(&in, 0, sizeof(in));
+        in.sin_family      = AF_INET;
+        in.sin_port        = htons(atoi(spec));
+        in.sin_addr.s_addr = htonl(INADDR_ANY);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        int yes = 1;
+        (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (bind(fd, (struct sockaddr *)&in, sizeof(in)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ---------- hot upgrade ----------
+
+// Old server, on SIGUSR2: start the binary now at our path as a sibling
+// (a grandchild, so never ours to reap) and send it the listeners, the
+// hub and the UDP process. We keep accepting until it says it is ready.
+static void start_upgrade(int argc, char *argv[]) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+        perror("upgrade: socketpair");
+        return;
+    }
+    char fd_arg[16];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", sv[1]);
+    char **args = calloc((size_t)argc + 3, sizeof(*args));
+    if (!args) {
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--upgrade-fd") == 0 && i + 1 < argc) {
+            i++;
+            continue;
+        }
+        args[n++] = argv[i];
+    }
+    args[n++] = "--upgrade-fd";
+    args[n++] = fd_arg;
+
+    pid_t mid = fork();
+    if (mid == 0) {
+        if (fork() == 0) {
+            close_listeners(-1);
+            close(hub_fd);
+            close(sv[0]);
+            sigprocmask(SIG_SETMASK, &accept_mask, NULL);
+            execvp(args[0], args);
+            _exit(127);
+        }
+        _exit(0);
+    }
+    free(args);
+    close(sv[1]);
+    int status = 1;
+    if (mid < 0 || waitpid(mid, &status, 0) < 0 || status != 0) {
+        perror("upgrade: fork");
+        close(sv[0]);
+        return;
+    }
+
+    struct up_listeners ul;
+    memset(&ul, 0, sizeof(ul));
+    ul.type    = UP_LISTENERS;
+    ul.version = UP_VERSION;
+    ul.pid     = getpid();
+    ul.hub_pid = hub_pid;
+    ul.udp_pid = udp_pid > 0 ? udp_pid : 0;
+    memcpy(ul.slot_owner, stats_owner, sizeof(ul.slot_owner));
+    // pidfds for the new server to watch them by. Our own children cannot
+    // be reaped meanwhile, so their pids still name them.
+    int hub_pf = hub_pidfd, udp_pf = udp_pidfd;
+    if (hub_pid > 0 && !hub_adopted) hub_pf = pidfd_open(hub_pid, 0);
+    if (udp_pid > 0 && !udp_adopted) udp_pf = pidfd_open(udp_pid, 0);
+    int fds[UP_MAX_FDS], nfds = 0;
+    int have[] = { lsock, usock, metrics_fd, udp_fd,
+                   hub_pid > 0 ? hub_fd : -1, hub_pid > 0 ? hub_map_fd() : -1,
+                   hub_pid > 0 ? hub_pf : -1, udp_pid > 0 ? udp_pf : -1 };
+    for (int i = 0; i < UP_MAX_FDS; i++) {
+        if (have[i] < 0) continue;
+        ul.has |= (uint8_t)(1 << i);
+        fds[nfds++] = have[i];
+    }
+    int sent = up_send(sv[0], &ul, sizeof(ul), fds, nfds);
+    if (hub_pf >= 0 && hub_pf != hub_pidfd) close(hub_pf);
+    if (udp_pf >= 0 && udp_pf != udp_pidfd) close(udp_pf);
+    if (sent < 0) {
+        perror("upgrade: send listeners");
+        close(sv[0]);
+        return;
+    }
+    up_fd = sv[0];
+}
+
+// Old server: the new one wrote on the channel. 1 once it is ready to
+// take over; 0 otherwise, and the upgrade is off if it went away.
+static int upgrade_ready(void) {
+    struct up_ready r;
+    int fds[UP_MAX_FDS], nfds;
+    ssize_t n = up_recv(up_fd, &r, sizeof(r), fds, &nfds, MSG_DONTWAIT);
+    for (int i = 0; i < nfds; i++) close(fds[i]);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+    if (n == sizeof(r) && r.type == UP_READY) {
+        up_pid = r.pid;
         return 1;
     }
+    fprintf(stderr, "Upgrade failed: the new server exited before taking over\n");
+    close(up_fd);
+    up_fd = -1;
+    return 0;
+}
+
+// Old server, out of the accept loop: move every worker game across and
+// say we are done. Slot 0 is the new parent's from here on, and so are
+// the hub and the UDP process.
+static void hand_over(void) {
+    stats_use_slot(-1);
+    int games = 0;
+    if (n_workers > 0) {
+        games = workers_active();   // counted before the workers start sending
+        if (workers_export(up_fd) == 0) {
+            while (workers_active() > 0) (void)poll(NULL, 0, 1);
+        } else {
+            games = 0;
+        }
+    }
+    uint8_t end = UP_END;
+    if (up_send(up_fd, &end, sizeof(end), NULL, 0) < 0) perror("upgrade: end");
+    close(up_fd);
+    up_fd = -1;
+    log_event(LOG_HANDOFF, games, up_pid);
+}
+
+// New server, at startup: the old server's sockets, hub, UDP process and
+// stats slots. A hub or UDP process that did not come along is started
+// afresh later. 0 on success, -1 on error.
+static int take_listeners(void) {
+    struct up_listeners ul;
+    int fds[UP_MAX_FDS], nfds;
+    ssize_t n = up_recv(up_fd, &ul, sizeof(ul), fds, &nfds, 0);
+    if (n != sizeof(ul) || ul.type != UP_LISTENERS || ul.version != UP_VERSION) {
+        fprintf(stderr, "upgrade: no usable listeners from the old server\n");
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        return -1;
+    }
+    int map_fd = -1;
+    int *mine[] = { &lsock, &usock, &metrics_fd, &udp_fd, &hub_fd, &map_fd,
+                    &hub_pidfd, &udp_pidfd };
+    for (int i = 0, k = 0; i < UP_MAX_FDS && k < nfds; i++) {
+        if (ul.has & (1 << i)) *mine[i] = fds[k++];
+    }
+    if (hub_fd >= 0 && (map_fd < 0 || hub_setup(map_fd) < 0)) {
+        if (map_fd >= 0) close(map_fd);
+        close(hub_fd);
+        hub_fd = -1;
+    }
+    if (hub_fd >= 0) {
+        hub_pid     = ul.hub_pid;
+        hub_adopted = 1;
+    } else if (hub_pidfd >= 0) {
+        close(hub_pidfd);
+        hub_pidfd = -1;
+    }
+    if (ul.udp_pid > 0 && udp_fd >= 0) {
+        udp_pid     = ul.udp_pid;
+        udp_adopted = 1;
+        stats_owner[STATS_SLOTS - 1] = udp_pid;
+    } else if (udp_pidfd >= 0) {
+        close(udp_pidfd);
+        udp_pidfd = -1;
+    }
+    memcpy(slot_inherited, ul.slot_owner, sizeof(slot_inherited));
+    up_pid = ul.pid;
+    return lsock >= 0 ? 0 : -1;
+}
+
+// New server: games from the old one, then UP_END (or the old server
+// going away).
+static void take_games(void) {
+    unsigned char msg[UP_MSG_MAX];
+    int fds[UP_MAX_FDS], nfds;
+    for (;;) {
+        ssize_t n = up_recv(up_fd, msg, sizeof(msg), fds, &nfds, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n > 0 && msg[0] == UP_SESSION && nfds == 1) {
+            if (n_workers > 0 && workers_resume(msg, (size_t)n, fds[0]) == 0) {
+                resumed++;
+            } else {
+                close(fds[0]);
+            }
+            continue;
+        }
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        if (n > 0 && msg[0] != UP_END) continue;
+
+        close(up_fd);
+        up_fd       = -1;
+        taking_over = 0;
+        stats_set_active((uint64_t)workers_active());
+        log_event(LOG_RESUMED, resumed, up_pid);
+        return;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *metrics_spec = NULL;
+    const char *capture_dir  = NULL;
+    const char *unix_path    = NULL;
+    int udp_port = 0;
+    int resume_secs = 0;
+    int bad_args = argc < 2;
+    for (int i = 2; i < argc && !bad_args; i++) {
+        if (strcmp(argv[i], "--evil") == 0) {
+            evil_mode = 1;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_spec = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_dir = argv[++i];
+        } else if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (strcmp(argv[i], "--udp") == 0 && i + 1 < argc) {
+            udp_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            n_workers = atoi(argv[++i]);
+            bad_args = n_workers < 1 || n_workers > WORKER_MAX;
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replay_mode = 1;
+        } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            resume_secs = atoi(argv[++i]);
+            bad_args = resume_secs < 1;
+        } else if (strcmp(argv[i], "--upgrade-fd") == 0 && i + 1 < argc) {
+            // Not for people: the old server passes it on SIGUSR2.
+            up_fd       = atoi(argv[++i]);
+            taking_over = 1;
+        } else {
+            bad_args = 1;
+        }
+    }
+    if (bad_args) {
+        fprintf(stderr, "Usage: %s <port> [--evil] [--metrics <port>|<unix_path>]\n"
+                        "       [--capture <dir>] [--replay] [--udp <port>] [--unix <path>]\n"
+                        "       [--workers <1-%d>] [--resume <secs>]\n",
+                argv[0], WORKER_MAX);
+        return 1;
+    }
+
+    int port = atoi(argv[1]);
+
+    if (taking_over) {
+        if (take_listeners() < 0) return 1;
+        printf("Hangman server taking over port %d from pid %d\n", port, (int)up_pid);
+    } else {
+        lsock = open_tcp_listener(port);
+        if (lsock < 0) return 1;
+        printf("Hangman server listening on port %d\n", port);
+    }
 
     int active_clients = 0;
-    printf("Hangman server listening on port %d\n", port);
 
     load_words("hangman_words.txt");
     printf("Loaded %d words from hangman_words.txt\n", num_words);
+    if (index_build(&dict_index) < 0) {
+        perror("index_build");
+        return 1;
+    }
+    if (evil_mode) {
+        printf("Evil mode: secret word chosen adversarially\n");
+    }
 
-    for (;;) {
-        int status;
-        pid_t pid;
+    // Counters are best effort: a server without them still serves games.
+    // An upgraded server carries on with the old one's totals.
+    if ((!taking_over || stats_attach(port) < 0) && stats_setup(port) < 0) {
+        perror("stats_setup");
+    }
+    fr_init(0, clock_hz());
 
+    if (capture_dir) {
+        if (cap_setup(capture_dir) < 0) {
+            perror(capture_dir);
+            return 1;
+        }
+        printf("Capturing solo games to %s\n", capture_dir);
+    }
+    if (replay_mode) {
+        printf("Replay mode: clients may choose the secret word\n");
+    }
+
+    // Games a crashed server or child left behind wait here for their
+    // clients; the scan hands them over to whoever resumes them.
+    if (resume_secs > 0) {
+        if (sesstab_setup(port, resume_secs) < 0) {
+            perror("sesstab_setup");
+            return 1;
+        }
+        uint32_t expired;
+        uint64_t took_ns;
+        int orphaned = sesstab_recover(&expired, &took_ns);
+        printf("Resumable games for %d s; session table: %d orphaned, %u expired, "
+               "%u slots scanned in %.2f ms\n",
+               resume_secs, orphaned, expired, SESSTAB_SLOTS, (double)took_ns / 1e6);
+    }
+
+    if (metrics_spec) {
+        if (metrics_fd < 0) metrics_fd = open_metrics_listener(metrics_spec);
+        if (metrics_fd < 0) {
+            perror("metrics listener");
+            return 1;
+        }
+        printf("Metrics on %s\n", metrics_spec);
+    }
+
+    // Taking over, the old server's hub and UDP process carry on serving.
+    if (!hub_adopted && start_room_hub() < 0) {
+        return 1;
+    }
+    if (udp_port > 0) {
+        if (udp_fd < 0) udp_fd = open_udp_socket(udp_port);
+        if (udp_fd < 0 || (!udp_adopted && start_udp() < 0)) {
+            return 1;
+        }
+        printf("UDP games on port %d\n", udp_port);
+    }
+
+    // Opened after the hub and UDP forks, so only game children inherit it.
+    if (unix_path) {
+        if (usock < 0) usock = open_unix_listener(unix_path);
+        if (usock < 0) {
+            perror(unix_path);
+            return 1;
+        }
+        printf("Also listening on %s\n", unix_path);
+    }
+
+    // SIGTERM drains the server: stop accepting, let running games
+    // finish, then exit. Used to take a backend out from behind a proxy.
+    // SIGUSR2 hands the server over to the binary now at its path.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+    sigset_t ctl;
+    sigemptyset(&ctl);
+    sigaddset(&ctl, SIGTERM);
+    sigaddset(&ctl, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &ctl, &accept_mask);
+
+    // Threads start with SIGTERM and SIGUSR2 blocked, so they reach the
+    // accept loop. Worker slots skip any the old server still writes.
+    if (n_workers > 0) {
+        int first = 1;
+        for (int i = 1; i < first + n_workers && i < STATS_SLOTS - 1; i++) {
+            if (!slot_free(i)) first = i + 1;
+        }
+        for (int i = first; i < first + n_workers && i < STATS_SLOTS; i++) stats_owner[i] = getpid();
+        if (workers_start(n_workers, first, hub_fd, &dict_index, evil_mode, replay_mode) < 0) {
+            perror("workers_start");
+            return 1;
+        }
+        printf("Games run on %d worker threads\n", n_workers);
+    }
+
+    // From here on the accept loop logs through the async writer; flush
+    // what stdio holds first so lines stay in order. The hub is forked
+    // already, so it never inherits the writer thread.
+    fflush(stdout);
+    if (log_start(STDOUT_FILENO) < 0) {
+        perror("log_start");
+        return 1;
+    }
+
+    // Everything is up: the old server stops accepting and sends its games.
+    if (taking_over) {
+        struct up_ready r = { .type = UP_READY, .pid = getpid() };
+        if (up_send(up_fd, &r, sizeof(r), NULL, 0) < 0) {
+            perror("upgrade: ready");
+            if (hub_pid > 0 && !hub_adopted) kill(hub_pid, SIGTERM);
+            if (udp_pid > 0 && !udp_adopted) kill(udp_pid, SIGTERM);
+            return 1;
+        }
+    }
+
+    int handed_over = 0;
+    while (!draining) {
         // Reap finished children BEFORE accept()
-        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-            if (active_clients > 0) {
-                active_clients--;
-                printf("Client exited, active_clients = %d\n", active_clients);
-            }
+        reap_children(&active_clients);
+
+        if (upgrade_wanted) {
+            upgrade_wanted = 0;
+            if (up_fd < 0) start_upgrade(argc, argv);
         }
 
-        int client_fd = accept(lsock, NULL, NULL);
+        int client_fd = accept_any();
+        if (client_fd == -2) {
+            if (taking_over) {
+                take_games();
+            } else if (upgrade_ready()) {
+                handed_over = 1;
+                break;
+            }
+            continue;
+        }
+        if (client_fd == -3) {
+            reap_adopted();
+            continue;
+        }
         if (client_fd < 0) {
-            perror("accept");
+            if (errno != EINTR && errno != EAGAIN) perror("accept");
             continue;
         }
 
         // Reap children that might have finished while we were blocked in accept()
-        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-            if (active_clients > 0) {
-                active_clients--;
-                printf("Client exited, active_clients = %d\n", active_clients);
+        reap_children(&active_clients);
+        TRACE2(accept, client_fd, active_clients);
+
+        if (n_workers > 0) {
+            // A worker owns the connection from here on.
+            int32_t id = workers_submit(client_fd);
+            if (id >= 0) {
+                int active = workers_active();
+                stats_add(STAT_ACCEPTED, 1);
+                stats_set_active((uint64_t)active);
+                log_event(LOG_ACCEPTED, id, active);
+                continue;
             }
         }
 
         // Enforce MAX_CLIENTS with "server-overloaded" message packet
-        if (active_clients >= MAX_CLIENTS) {
+        if (n_workers > 0 || active_clients >= MAX_CLIENTS) {
             (void)send_message_packet(client_fd, "server-overloaded");
             close(client_fd);
-            printf("Rejected client (server busy). active_clients = %d\n", active_clients);
+            stats_add(STAT_REJECTED, 1);
+            TRACE1(reject, active_clients);
+            log_event(LOG_REJECTED, 0, active_clients);
             continue;
         }
 
+        int slot = 1;
+        while (slot < STATS_SLOTS && !slot_free(slot)) slot++;
+
         pid_t child = fork();
         if (child < 0) {
             perror("fork");
@@ -402,18 +1292,66 @@ int main(int argc, char *argv[]) {
 
         if (child == 0) {
             // Child
-            close(lsock);
+            close_listeners(-1);
+            signal(SIGTERM, SIG_DFL);
+            sigprocmask(SIG_SETMASK, &accept_mask, NULL);
+            session_id = (uint32_t)getpid();
+            stats_use_slot(slot);
+            fr_init(session_id, clock_hz());
+            cap_begin();
             handle_client(client_fd);
+            if (hub_session_watched(session_id)) {
+                hub_session_end(hub_fd, session_id);
+            }
+            if (cap_finish(session_id) < 0) {
+                perror("capture");
+            }
             close(client_fd);
             _exit(0);
         } else {
             // Parent
+            TRACE2(fork, child, slot);
             close(client_fd);
+            if (slot < STATS_SLOTS) stats_owner[slot] = child;
             active_clients++;
-            printf("Accepted new client, active_clients = %d\n", active_clients);
+            stats_add(STAT_ACCEPTED, 1);
+            stats_set_active((uint64_t)active_clients);
+            log_event(LOG_ACCEPTED, child, active_clients);
         }
     }
 
+    // A hot upgrade moves the worker games first; an upgrade still
+    // starting up is called off by closing the channel.
+    if (handed_over) {
+        hand_over();
+    } else if (up_fd >= 0) {
+        close(up_fd);
+    }
+
+    // Draining: the listeners go first, so a proxy's next connect fails
+    // and it routes around us. The hub and the UDP process go last, unless
+    // the new server has them.
     close(lsock);
+    if (usock >= 0) {
+        close(usock);
+        // After a hot upgrade the path belongs to the new server.
+        if (!handed_over) (void)unlink(unix_path);
+    }
+    if (metrics_fd >= 0) close(metrics_fd);
+    if (hub_fd >= 0 && !handed_over) hub_drain(hub_fd);     // and its copy of metrics_fd
+    if (udp_fd >= 0) close(udp_fd);
+    log_event(LOG_DRAINING, 0, active_clients + workers_active());
+    while (active_clients > 0 || workers_active() > 0) {
+        (void)poll(NULL, 0, 100);
+        reap_children(&active_clients);
+    }
+    // Handed over, they outlive us; init reaps them, not the new server.
+    if (!handed_over) {
+        if (hub_pid > 0) kill(hub_pid, SIGTERM);
+        if (udp_pid > 0) kill(udp_pid, SIGTERM);
+        while (waitpid(-1, NULL, 0) > 0) {
+        }
+    }
+    (void)poll(NULL, 0, 2 * LOG_FLUSH_MS);     // let the log writer catch up
     return 0;
 }
@@ -0,0 +1,273 @@
+#include "hangman_sesstab.h"
+
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct sesstab_state {
+    uint32_t            seq;        // odd while being written, 0 = never written
+    struct session_pack pack;
+};
+
+struct sesstab_slot {
+    uint64_t             token;
+    struct sesstab_state copy[2];
+};
+
+struct sesstab_segment {
+    uint32_t            magic;      // written last, once the rest is valid
+    uint32_t            version;
+    uint32_t            slots;
+    uint32_t            next;       // where the next claim starts looking (atomic)
+    _Alignas(64) uint64_t head[SESSTAB_SLOTS];  // owner | since << 32
+    struct sesstab_slot slot[SESSTAB_SLOTS];
+};
+
+static struct sesstab_segment *tab;
+static uint32_t                window;
+
+static uint64_t make_head(uint32_t owner, uint32_t since) {
+    return (uint64_t)owner | (uint64_t)since << 32;
+}
+
+static uint32_t head_owner(uint64_t h) { return (uint32_t)h; }
+static uint32_t head_since(uint64_t h) { return (uint32_t)(h >> 32); }
+
+// Seconds on CLOCK_MONOTONIC, which every process on the machine shares.
+static uint32_t now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+static int expired(uint64_t h, uint32_t now) {
+    return head_owner(h) == SESSTAB_ORPHAN && now - head_since(h) > window;
+}
+
+// A zombie answers kill() too, and a crashed server stays one until
+// whatever started it reaps it: ask /proc for the state.
+static int pid_alive(uint32_t pid) {
+    if (kill((pid_t)pid, 0) < 0 && errno != EPERM) return 0;
+    char path[32], buf[128];
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 1;
+    buf[n] = '\0';
+    const char *state = strrchr(buf, ')');     // "pid (comm) S ..."
+    return !state || state[1] != ' ' || state[2] != 'Z';
+}
+
+int sesstab_setup(int port, int window_secs) {
+    char name[64];
+    snprintf(name, sizeof(name), "/hangman_sessions.%d", port);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        (st.st_size != (off_t)sizeof(*tab) && ftruncate(fd, sizeof(*tab)) < 0)) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, sizeof(*tab), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    tab    = p;
+    window = (uint32_t)window_secs;
+    if (__atomic_load_n(&tab->magic, __ATOMIC_ACQUIRE) != SESSTAB_MAGIC ||
+        tab->version != SESSTAB_VERSION || tab->slots != SESSTAB_SLOTS) {
+        // New, or left by another layout: nothing in it can be resumed.
+        memset(tab->head, 0, sizeof(tab->head));
+        tab->version = SESSTAB_VERSION;
+        tab->slots   = SESSTAB_SLOTS;
+        tab->next    = 0;
+        __atomic_store_n(&tab->magic, SESSTAB_MAGIC, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+int sesstab_enabled(void) {
+    return tab != NULL;
+}
+
+int sesstab_recover(uint32_t *n_expired, uint64_t *took_ns) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint32_t now = now_s();
+
+    // Games of one owner are spread all over the table, and kill() is a
+    // syscall: remember the last few answers.
+    enum { SEEN = 16 };
+    uint32_t seen_pid[SEEN] = { 0 };
+    int      seen_alive[SEEN];
+    unsigned seen_next = 0;
+
+    int orphaned = 0;
+    uint32_t freed = 0;
+    for (uint32_t i = 0; i < SESSTAB_SLOTS; i++) {
+        if ((i & 7) == 0) {
+            // Most lines are all free: one test per cache line of heads.
+            const uint64_t *line = &tab->head[i];
+            if ((line[0] | line[1] | line[2] | line[3] | line[4] | line[5] | line[6] | line[7]) == 0) {
+                i += 7;
+                continue;
+            }
+        }
+        uint64_t h = __atomic_load_n(&tab->head[i], __ATOMIC_RELAXED);
+        if (h == 0) continue;
+        uint32_t owner = head_owner(h);
+        if (owner == SESSTAB_ORPHAN) {
+            if (expired(h, now) &&
+                __atomic_compare_exchange_n(&tab->head[i], &h, 0, 0,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                freed++;
+            }
+            continue;
+        }
+        int k = 0;
+        while (k < SEEN && seen_pid[k] != owner) k++;
+        if (k == SEEN) {
+            k = (int)(seen_next++ % SEEN);
+            seen_pid[k]   = owner;
+            seen_alive[k] = pid_alive(owner);
+        }
+        if (!seen_alive[k] &&
+            __atomic_compare_exchange_n(&tab->head[i], &h, make_head(SESSTAB_ORPHAN, now), 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            orphaned++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *n_expired = freed;
+    *took_ns   = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ull +
+                 (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+    return orphaned;
+}
+
+int32_t sesstab_claim(uint64_t *token) {
+    uint32_t me    = (uint32_t)getpid();
+    uint32_t now   = now_s();
+    uint32_t start = __atomic_fetch_add(&tab->next, 1, __ATOMIC_RELAXED);
+    for (uint32_t k = 0; k < SESSTAB_SLOTS; k++) {
+        uint32_t i = (start + k) & (SESSTAB_SLOTS - 1);
+        uint64_t h = __atomic_load_n(&tab->head[i], __ATOMIC_RELAXED);
+        if (h != 0 && !expired(h, now)) continue;
+        if (!__atomic_compare_exchange_n(&tab->head[i], &h, make_head(me, 0), 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        uint64_t r = 0;
+        if (getrandom(&r, sizeof(r), 0) != (ssize_t)sizeof(r)) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            r = (uint64_t)ts.tv_nsec * 0x9e3779b97f4a7c15ull ^ me;
+        }
+        struct sesstab_slot *b = &tab->slot[i];
+        b->token = (uint64_t)i << SESSTAB_TOKEN_RANDOM |
+                   (r & ((1ull << SESSTAB_TOKEN_RANDOM) - 1));
+        b->copy[0].seq = 0;
+        b->copy[1].seq = 0;
+        *token = b->token;
+        return (int32_t)i;
+    }
+    return -1;
+}
+
+// The copy holding the newest complete state, or -1 if there is none.
+static int newest(const struct sesstab_slot *b, struct session_pack *out) {
+    int best = -1;
+    uint32_t best_seq = 0;
+    for (int c = 0; c < 2; c++) {
+        const struct sesstab_state *st = &b->copy[c];
+        uint32_t seq = __atomic_load_n(&st->seq, __ATOMIC_ACQUIRE);
+        if (seq == 0 || (seq & 1) || seq <= best_seq) continue;
+        struct session_pack p;
+        memcpy(&p, &st->pack, sizeof(p));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&st->seq, __ATOMIC_RELAXED) != seq) continue;
+        best     = c;
+        best_seq = seq;
+        if (out) *out = p;
+    }
+    return best;
+}
+
+void sesstab_save(int32_t slot, const struct session *s) {
+    struct sesstab_slot *b = &tab->slot[slot];
+    int cur = newest(b, NULL);
+    uint32_t seq = cur < 0 ? 2 : b->copy[cur].seq + 2;
+    struct sesstab_state *st = &b->copy[cur < 0 ? 0 : 1 - cur];
+
+    __atomic_store_n(&st->seq, seq - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    session_pack(s, &st->pack);
+    __atomic_store_n(&st->seq, seq, __ATOMIC_RELEASE);
+}
+
+void sesstab_release(int32_t slot, int resumable) {
+    __atomic_store_n(&tab->head[slot], resumable ? make_head(SESSTAB_ORPHAN, now_s()) : 0,
+                     __ATOMIC_RELEASE);
+}
+
+// Compare tokens without an early exit, so timing does not tell a client
+// how many leading bits of a guess were right.
+static int token_equal(uint64_t a, uint64_t b) {
+    volatile uint64_t diff = a ^ b;
+    return diff == 0;
+}
+
+int32_t sesstab_adopt(uint64_t token, struct session_pack *pack) {
+    uint64_t i = token >> SESSTAB_TOKEN_RANDOM;
+    if (i >= SESSTAB_SLOTS) return -1;
+    uint64_t h = __atomic_load_n(&tab->head[i], __ATOMIC_ACQUIRE);
+    if (head_owner(h) != SESSTAB_ORPHAN || expired(h, now_s())) return -1;
+    // Check the token before taking the slot: a wrong guess must not hold
+    // the orphan, even briefly, against the client it belongs to. The
+    // token only changes when the slot is claimed, which the CAS below
+    // would then see.
+    struct sesstab_slot *b = &tab->slot[i];
+    if (!token_equal(__atomic_load_n(&b->token, __ATOMIC_RELAXED), token)) return -1;
+    if (!__atomic_compare_exchange_n(&tab->head[i], &h, make_head((uint32_t)getpid(), 0), 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return -1;
+    }
+    if (!token_equal(b->token, token) || newest(b, pack) < 0 ||
+        pack->word_idx < 0 || pack->word_idx >= num_words || pack->num_incorrect >= MAX_INCORRECT) {
+        // Not this client's game, or not one this dictionary can carry on:
+        // leave it for the window to run out.
+        __atomic_store_n(&tab->head[i], h, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return (int32_t)i;
+}
+
+void sesstab_rehome(int32_t slot) {
+    __atomic_store_n(&tab->head[slot], make_head((uint32_t)getpid(), 0), __ATOMIC_RELEASE);
+}
+
+int sesstab_orphan_owner(pid_t pid) {
+    uint32_t owner = (uint32_t)pid, now = now_s();
+    int n = 0;
+    for (uint32_t i = 0; i < SESSTAB_SLOTS; i++) {
+        uint64_t h = __atomic_load_n(&tab->head[i], __ATOMIC_RELAXED);
+        if (head_owner(h) == owner &&
+            __atomic_compare_exchange_n(&tab->head[i], &h, make_head(SESSTAB_ORPHAN, now), 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            n++;
+        }
+    }
+    return n;
+}
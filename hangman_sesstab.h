@@ -0,0 +1,71 @@
+#ifndef HANGMAN_SESSTAB_H
+#define HANGMAN_SESSTAB_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "hangman_game.h"
+
+// Session table (--resume <secs>): every resumable solo game keeps its
+// compact state (a session_pack) in a shared-memory segment,
+// "/hangman_sessions.<port>", that outlives the process writing it. When
+// the process playing a game dies, whether a forked child or the whole
+// server, the game stays in the table as an orphan; a client that
+// reconnects within the window with the game's token carries on from
+// its last answered guess, on whichever process takes the connection.
+//
+// The segment has two parts. The heads are one 8-byte word per slot,
+// the owner's pid (0 = free, SESSTAB_ORPHAN = nobody) and the second the
+// slot was orphaned. Recovery reads only these, so a million slots are
+// 8 MB of sequential reads. The bodies hold the token and two copies of
+// the state, written alternately under a sequence number that is odd
+// while a copy is being written: a writer killed mid-write leaves an odd
+// copy, and the reader takes the other one, one guess older.
+//
+// A slot has one writer, its owner; a head changes hands only by
+// compare-and-swap, so two processes adopting the same orphan cannot
+// both win.
+
+#define SESSTAB_SLOTS   (1u << 20)
+#define SESSTAB_MAGIC   0x484d5353u     // "HMSS"
+#define SESSTAB_VERSION 1
+#define SESSTAB_ORPHAN  0xffffffffu
+
+// The token a client resumes with: the slot in the top bits, so lookup is
+// an index, and 40 random bits so tokens cannot be guessed from each other.
+#define SESSTAB_TOKEN_RANDOM 40
+
+// Attach to the port's table, creating it if there is none. An existing
+// table is kept, orphans and all. window is how long, in seconds, an
+// orphan may be resumed. 0 on success, -1 on error.
+int sesstab_setup(int port, int window);
+
+int sesstab_enabled(void);
+
+// Orphan the games of every owner that is gone and free orphans past the
+// window. Run once at startup, before any claim. Returns the number of
+// games orphaned; expired and took_ns report the rest.
+int sesstab_recover(uint32_t *expired, uint64_t *took_ns);
+
+// A slot for a new game, owned by this process. The token goes to the
+// client. Returns the slot, or -1 if the table is full.
+int32_t sesstab_claim(uint64_t *token);
+
+// Record the state after an answered guess, before the reply goes out.
+void sesstab_save(int32_t slot, const struct session *s);
+
+// The game is done with: free the slot, or orphan it so the client can
+// come back (a disconnect mid-game).
+void sesstab_release(int32_t slot, int resumable);
+
+// Take over the orphan token names, if it is still in the window. Fills
+// pack with the newest complete state. Returns the slot, or -1.
+int32_t sesstab_adopt(uint64_t token, struct session_pack *pack);
+
+// Move a slot to this process (a game handed over on hot upgrade).
+void sesstab_rehome(int32_t slot);
+
+// Parent: pid died mid-game (a crashed child); orphan its slots.
+int sesstab_orphan_owner(pid_t pid);
+
+#endif
@@ -0,0 +1,146 @@
+#include "hangman_stats.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+_Thread_local struct stats_block *stats_mine;
+
+static struct stats_segment *seg;
+
+const char *const stat_names[STAT_COUNT] = {
+    [STAT_GAMES]     = "games",
+    [STAT_WON]       = "won",
+    [STAT_LOST]      = "lost",
+    [STAT_ABANDONED] = "abandoned",
+    [STAT_GUESSES]   = "guesses",
+    [STAT_HINTS]     = "hints",
+    [STAT_ACCEPTED]  = "accepted",
+    [STAT_REJECTED]  = "rejected",
+};
+
+static void segment_name(int port, char *out, size_t out_len) {
+    snprintf(out, out_len, "/hangman_stats.%d", port);
+}
+
+// Ticks of stats_clock() per second, measured against CLOCK_MONOTONIC.
+static uint64_t calibrate_clock(void) {
+#if defined(__x86_64__)
+    struct timespec t0, t1, pause = { .tv_sec = 0, .tv_nsec = 20 * 1000000 };
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t c0 = stats_clock();
+    nanosleep(&pause, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    uint64_t c1 = stats_clock();
+    double ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+    return (uint64_t)((double)(c1 - c0) * 1e9 / ns);
+#else
+    return 1000000000ull;
+#endif
+}
+
+int stats_setup(int port) {
+    char name[64];
+    segment_name(port, name, sizeof(name));
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, sizeof(*seg)) < 0) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    // A fresh server starts from zero; readers check magic before trusting it.
+    seg = p;
+    memset(seg, 0, sizeof(*seg));
+    seg->version = STATS_VERSION;
+    seg->slots   = STATS_SLOTS;
+    seg->clock_hz = calibrate_clock();
+    __atomic_store_n(&seg->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+    stats_mine = &seg->block[0];
+    return 0;
+}
+
+int stats_attach(int port) {
+    char name[64];
+    segment_name(port, name, sizeof(name));
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return -1;
+    void *p = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    struct stats_segment *s = p;
+    if (__atomic_load_n(&s->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC ||
+        s->version != STATS_VERSION || s->slots != STATS_SLOTS) {
+        munmap(p, sizeof(*seg));
+        return -1;
+    }
+    seg = s;
+    stats_mine = &seg->block[0];
+    return 0;
+}
+
+void stats_use_slot(int slot) {
+    stats_mine = seg && slot >= 0 && slot < STATS_SLOTS ? &seg->block[slot] : NULL;
+}
+
+const struct stats_segment *stats_open(int port) {
+    char name[64];
+    segment_name(port, name, sizeof(name));
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    void *p = mmap(NULL, sizeof(struct stats_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+
+    const struct stats_segment *s = p;
+    if (__atomic_load_n(&s->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC ||
+        s->version != STATS_VERSION || s->slots != STATS_SLOTS) {
+        munmap(p, sizeof(struct stats_segment));
+        return NULL;
+    }
+    return s;
+}
+
+void stats_total(const struct stats_segment *s, uint64_t *total) {
+    memset(total, 0, STAT_COUNT * sizeof(*total));
+    for (int i = 0; i < STATS_SLOTS; i++) {
+        for (int c = 0; c < STAT_COUNT; c++) {
+            total[c] += __atomic_load_n(&s->block[i].c[c], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+uint64_t stats_hist_total(const struct stats_segment *s, enum stat_hist h,
+                          uint64_t *buckets) {
+    uint64_t sum = 0;
+    memset(buckets, 0, HIST_BUCKETS * sizeof(*buckets));
+    for (int i = 0; i < STATS_SLOTS; i++) {
+        const struct stats_block *b = &s->block[i];
+        for (int k = 0; k < HIST_BUCKETS; k++) {
+            buckets[k] += __atomic_load_n(&b->hist[h][k], __ATOMIC_RELAXED);
+        }
+        sum += __atomic_load_n(&b->hist_sum[h], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+uint64_t stats_hist_upper(int i) {
+    if (i < HIST_SUB) return (uint64_t)i;
+    int k = i / HIST_SUB, sub = i % HIST_SUB;
+    int shift = k - 1;      // exponent - HIST_SUB_BITS
+    return (((uint64_t)(HIST_SUB + sub + 1)) << shift) - 1;
+}
+
+const struct stats_segment *stats_segment(void) {
+    return seg;
+}
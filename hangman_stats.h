@@ -0,0 +1,145 @@
+#ifndef HANGMAN_STATS_H
+#define HANGMAN_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Game counters in a POSIX shared-memory segment ("/hangman_stats.<port>").
+//
+// The parent creates the segment before forking anything and hands each
+// child a slot; slot 0 is the parent's own (connections, active gauge).
+// A slot is a cache-line-aligned block of counters and histograms written
+// only by its current owner. With a single writer an update is a relaxed
+// load and store, not a locked read-modify-write: no locks, no syscalls
+// and no cache-line sharing on the game path. Slots are never cleared, so
+// totals are the sum over all slots; the parent, the hub or an external
+// reader (hangman_top) sums them whenever it wants a number.
+
+#define STATS_SLOTS   64
+#define STATS_MAGIC   0x484d5354u     // "HMST"
+#define STATS_VERSION 3
+
+enum stat_counter {
+    STAT_GAMES,         // solo games started
+    STAT_WON,
+    STAT_LOST,
+    STAT_ABANDONED,     // client left mid-game
+    STAT_GUESSES,
+    STAT_HINTS,
+    STAT_ACCEPTED,      // connections handed to a child (parent)
+    STAT_REJECTED,      // "server-overloaded" (parent)
+    STAT_COUNT
+};
+
+// HDR-style histograms: log-linear buckets, 2^HIST_SUB_BITS per power of
+// two, so every bucket is within 12.5% of its value. Values below
+// 2^HIST_SUB_BITS get exact buckets; values past 2^HIST_MAX_EXP clamp.
+#define HIST_SUB_BITS 3
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP  47
+#define HIST_BUCKETS  ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB)
+
+// Latencies are in stats_clock() ticks; the segment records the tick rate.
+enum stat_hist {
+    HIST_GUESS,         // guess received -> board (or end) sent
+    HIST_START,         // welcome sent -> start frame received
+    HIST_GAME_BYTES,    // bytes sent to the player per solo game
+    HIST_COUNT
+};
+
+struct stats_block {
+    _Alignas(64) uint64_t c[STAT_COUNT];
+    uint64_t active;                    // gauge: live children (parent slot)
+    uint64_t hist_sum[HIST_COUNT];
+    uint64_t hist[HIST_COUNT][HIST_BUCKETS];
+};
+
+struct stats_segment {
+    uint32_t           magic;
+    uint32_t           version;
+    uint32_t           slots;
+    uint64_t           clock_hz;        // stats_clock() ticks per second
+    struct stats_block block[STATS_SLOTS];
+};
+
+// This thread's block; NULL (counting disabled) until stats_use_slot.
+// Worker threads each take their own slot, so every slot keeps one writer.
+extern _Thread_local struct stats_block *stats_mine;
+
+// Parent: create (or reset) the segment for port and count into slot 0.
+// 0 on success, -1 on error.
+int stats_setup(int port);
+
+// Hot upgrade: map the segment the old server set up for port without
+// clearing it, and count into slot 0. 0 on success, -1 on error.
+int stats_attach(int port);
+
+// Child or worker thread: count into slot from now on (-1: stop counting).
+void stats_use_slot(int slot);
+
+// Reader: map an existing segment read-only. NULL on error.
+const struct stats_segment *stats_open(int port);
+
+// Sum every slot into total[STAT_COUNT].
+void stats_total(const struct stats_segment *seg, uint64_t *total);
+
+// Sum histogram h over every slot into buckets[HIST_BUCKETS]; returns the
+// sum of recorded values.
+uint64_t stats_hist_total(const struct stats_segment *seg, enum stat_hist h,
+                          uint64_t *buckets);
+
+// Largest value that lands in bucket i.
+uint64_t stats_hist_upper(int i);
+
+// Shared segment of this process (after stats_setup), or NULL.
+const struct stats_segment *stats_segment(void);
+
+extern const char *const stat_names[STAT_COUNT];
+
+// Cheap monotonic timestamp for latency histograms: the cycle counter on
+// x86-64 (an invariant TSC on anything recent), nanoseconds elsewhere.
+static inline uint64_t stats_clock(void) {
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Wall-time nanoseconds on CLOCK_MONOTONIC, for deadlines and durations
+// that have to mean the same in every process.
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Single-writer update: readers may see the old or new value, never a torn one.
+static inline void stats_bump(uint64_t *p, uint64_t n) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline void stats_add(enum stat_counter c, uint64_t n) {
+    if (stats_mine) stats_bump(&stats_mine->c[c], n);
+}
+
+static inline void stats_set_active(uint64_t n) {
+    if (stats_mine) __atomic_store_n(&stats_mine->active, n, __ATOMIC_RELAXED);
+}
+
+static inline int stats_hist_index(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    int i = (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)(v >> (e - HIST_SUB_BITS)) - HIST_SUB;
+    return i < HIST_BUCKETS ? i : HIST_BUCKETS - 1;
+}
+
+static inline void stats_record(enum stat_hist h, uint64_t v) {
+    if (!stats_mine) return;
+    stats_bump(&stats_mine->hist[h][stats_hist_index(v)], 1);
+    stats_bump(&stats_mine->hist_sum[h], v);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_stats.h"
+
+// Live view of a running server's game counters: maps the server's
+// shared stats segment read-only and prints totals plus per-second rates
+// every interval. Costs the server nothing; no socket, no signal.
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void print_line(const uint64_t *total, const uint64_t *prev, double dt) {
+    for (int c = 0; c < STAT_COUNT; c++) {
+        printf("%s %llu", stat_names[c], (unsigned long long)total[c]);
+        if (prev) printf(" (%.1f/s)", (double)(total[c] - prev[c]) / dt);
+        printf(c + 1 < STAT_COUNT ? "  " : "\n");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <server_port> [interval_sec (0 = once)]\n", argv[0]);
+        return 1;
+    }
+    int port = atoi(argv[1]);
+    double interval = argc > 2 ? atof(argv[2]) : 1.0;
+
+    const struct stats_segment *seg = stats_open(port);
+    if (!seg) {
+        fprintf(stderr, "No stats segment for port %d (is the server running?)\n", port);
+        return 1;
+    }
+
+    uint64_t total[STAT_COUNT], prev[STAT_COUNT];
+    stats_total(seg, total);
+    print_line(total, NULL, 0);
+    if (interval <= 0) return 0;
+
+    double t0 = now_sec();
+    for (;;) {
+        usleep((useconds_t)(interval * 1e6));
+        for (int c = 0; c < STAT_COUNT; c++) prev[c] = total[c];
+        stats_total(seg, total);
+        double t1 = now_sec();
+        print_line(total, prev, t1 - t0);
+        t0 = t1;
+    }
+}
@@ -0,0 +1,93 @@
+#include "hangman_tourney.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hangman_dict.h"
+
+void tourney_init(struct tourney *t, uint32_t id, uint64_t now_ns) {
+    memset(t, 0, sizeof(*t));
+    t->id           = id;
+    t->start_ns     = now_ns;
+    t->end_ns       = now_ns + (uint64_t)TOURNEY_SECS * 1000000000ull;
+    t->next_push_ns = now_ns + (uint64_t)TOURNEY_STANDINGS_MS * 1000000ull;
+    for (int i = 0; i < TOURNEY_WORDS; i++) {
+        t->words[i] = rand() % num_words;
+    }
+}
+
+// Does a rank strictly ahead of b?
+static int ahead(const struct tourney_player *a, const struct tourney_player *b) {
+    if (a->solved != b->solved) return a->solved > b->solved;
+    if (a->misses != b->misses) return a->misses < b->misses;
+    return a->time_ns < b->time_ns;
+}
+
+static void place(struct tourney *t, struct tourney_player *p, int i) {
+    t->ranking[i] = p;
+    p->rank = i;
+}
+
+// Restore order around p after its score changed: slide it up or down
+// past the players it now beats or trails, and no further.
+static void resort(struct tourney *t, struct tourney_player *p) {
+    int i = p->rank;
+    while (i > 0 && ahead(p, t->ranking[i - 1])) {
+        place(t, t->ranking[i - 1], i);
+        i--;
+    }
+    while (i + 1 < t->n && ahead(t->ranking[i + 1], p)) {
+        place(t, t->ranking[i + 1], i);
+        i++;
+    }
+    place(t, p, i);
+}
+
+struct tourney_player *tourney_join(struct tourney *t, void *owner, uint64_t now_ns) {
+    if (t->n == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 16;
+        void *q = realloc(t->ranking, (size_t)cap * sizeof(*t->ranking));
+        if (!q) return NULL;
+        t->ranking = q;
+        t->cap = cap;
+    }
+    struct tourney_player *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    p->owner = owner;
+    p->num = (uint32_t)t->n + 1;
+    p->word_start_ns = now_ns;
+    place(t, p, t->n++);
+    resort(t, p);
+    return p;
+}
+
+int tourney_finish_word(struct tourney *t, struct tourney_player *p,
+                        int solved, int misses, uint64_t now_ns) {
+    p->time_ns += now_ns - p->word_start_ns;
+    p->solved += solved != 0;
+    p->misses += misses;
+    p->word++;
+    p->word_start_ns = now_ns;
+    resort(t, p);
+    return p->rank;
+}
+
+void tourney_row(const struct tourney *t, int i, char *out, size_t out_len) {
+    const struct tourney_player *p = t->ranking[i];
+    snprintf(out, out_len, "%d. #%u  %d/%d solved, %d misses, %llu.%03llus%s",
+             i + 1, p->num, p->solved, TOURNEY_WORDS, p->misses,
+             (unsigned long long)(p->time_ns / 1000000000ull),
+             (unsigned long long)(p->time_ns / 1000000ull % 1000),
+             p->owner ? "" : " (left)");
+}
+
+void tourney_free(struct tourney *t) {
+    for (int i = 0; i < t->n; i++) {
+        free(t->ranking[i]);
+    }
+    free(t->ranking);
+    t->ranking = NULL;
+    t->n = t->cap = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef HANGMAN_TOURNEY_H
+#define HANGMAN_TOURNEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Timed tournaments: every player gets the same word sequence and plays
+// it on a private clock (CLOCK_MONOTONIC, nanoseconds) that runs from the
+// board being sent to the word ending.
+//
+// Players are ranked by words solved (more first), then total misses,
+// then total clock time. The ranking is kept sorted as results arrive:
+// a finished word moves only that player, by the number of places it
+// actually gains or loses, so a standings push just reads the top rows.
+
+#define TOURNEY_WORDS        5
+#define TOURNEY_SECS         180
+#define TOURNEY_STANDINGS_MS 2000
+#define TOURNEY_TOP          5
+
+struct tourney_player {
+    void     *owner;            // NULL once disconnected (score still counts)
+    uint32_t  num;              // join order, 1-based: "player #num"
+    int       word;             // index into the sequence, TOURNEY_WORDS = done
+    int       solved;
+    int       misses;
+    uint64_t  time_ns;          // clock time of finished words
+    uint64_t  word_start_ns;
+    int       rank;             // index in tourney.ranking
+};
+
+struct tourney {
+    uint32_t                id;
+    int                     words[TOURNEY_WORDS];
+    uint64_t                start_ns, end_ns, next_push_ns;
+    struct tourney_player **ranking;    // best first
+    int                     n, cap;
+};
+
+// Set up a tournament starting now with a random word sequence.
+void tourney_init(struct tourney *t, uint32_t id, uint64_t now_ns);
+
+// Add a player at the rank its empty score earns. NULL on allocation failure.
+struct tourney_player *tourney_join(struct tourney *t, void *owner, uint64_t now_ns);
+
+// Record p's current word as solved or lost and start its clock on the
+// next one. Returns p's new rank (0-based).
+int tourney_finish_word(struct tourney *t, struct tourney_player *p,
+                        int solved, int misses, uint64_t now_ns);
+
+// Format standings row i ("2. #7  3/5 solved, 4 misses, 41.237s").
+void tourney_row(const struct tourney *t, int i, char *out, size_t out_len);
+
+void tourney_free(struct tourney *t);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HANGMAN_TRACE_H
+#define HANGMAN_TRACE_H
+
+// USDT (user-level statically defined tracing) probes, provider "hangman".
+//
+// With <sys/sdt.h> available (systemtap-sdt-dev / systemtap-sdt-devel),
+// each probe compiles to a single nop plus a note in the ELF .note.stapsdt
+// section; bpftrace, perf and systemtap attach to it at run time by
+// patching that nop, so an untraced server pays nothing. Without the
+// header, or with -DHANGMAN_NO_USDT, the probes compile away entirely.
+//
+// List them with:  bpftrace -l 'usdt:./hangman_server:*'
+// Example scripts: trace/*.bt
+
+#if defined(__has_include) && !defined(HANGMAN_NO_USDT)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HANGMAN_USDT 1
+#endif
+#endif
+
+#ifdef HANGMAN_USDT
+#define TRACE0(name)             DTRACE_PROBE(hangman, name)
+#define TRACE1(name, a)          DTRACE_PROBE1(hangman, name, a)
+#define TRACE2(name, a, b)       DTRACE_PROBE2(hangman, name, a, b)
+#define TRACE3(name, a, b, c)    DTRACE_PROBE3(hangman, name, a, b, c)
+#else
+#define TRACE0(name)             do { } while (0)
+#define TRACE1(name, a)          do { (void)(a); } while (0)
+#define TRACE2(name, a, b)       do { (void)(a); (void)(b); } while (0)
+#define TRACE3(name, a, b, c)    do { (void)(a); (void)(b); (void)(c); } while (0)
+#endif
+
+#endif
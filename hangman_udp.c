@@ -0,0 +1,250 @@
+#define _GNU_SOURCE     // recvmmsg, sendmmsg
+#include "hangman_udp.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "hangman_game.h"
+#include "hangman_proto.h"
+#include "hangman_stats.h"
+
+#define UDP_TABLE   (2 * UDP_MAX_SESSIONS)     // token hash, power of two
+#define UDP_REPLY_MAX (UDP_HDR + V2_GAME_END_MAX)
+
+struct udp_sess {
+    uint64_t           token;
+    struct sockaddr_in peer;
+    uint64_t           expire_ns;
+    uint32_t           last_seq;
+    int                finished;
+    struct session     s;
+    uint16_t           reply_len;
+    unsigned char      reply[UDP_REPLY_MAX];   // answer to last_seq
+};
+
+static struct udp_sess *sess;
+static int32_t         *table;      // -1 = empty, else index into sess
+static int32_t         *free_list;
+static int              n_free;
+static const struct word_index *udp_ix;
+static int              udp_evil;
+
+// ---------- token table ----------
+//
+// Linear probing with backward-shift deletion, so there are no
+// tombstones to clean up as games come and go.
+
+static size_t slot_of(uint64_t token) {
+    token ^= token >> 33;
+    token *= 0xff51afd7ed558ccdull;
+    token ^= token >> 33;
+    return (size_t)token & (UDP_TABLE - 1);
+}
+
+static struct udp_sess *lookup(uint64_t token) {
+    for (size_t i = slot_of(token); table[i] >= 0; i = (i + 1) & (UDP_TABLE - 1)) {
+        if (sess[table[i]].token == token) return &sess[table[i]];
+    }
+    return NULL;
+}
+
+static struct udp_sess *insert(uint64_t token) {
+    if (n_free == 0) return NULL;
+    int32_t idx = free_list[--n_free];
+    size_t i = slot_of(token);
+    while (table[i] >= 0) i = (i + 1) & (UDP_TABLE - 1);
+    table[i] = idx;
+    memset(&sess[idx], 0, sizeof(sess[idx]));
+    sess[idx].token = token;
+    return &sess[idx];
+}
+
+static void drop(struct udp_sess *u) {
+    size_t i = slot_of(u->token);
+    while (&sess[table[i]] != u) i = (i + 1) & (UDP_TABLE - 1);
+    table[i] = -1;
+
+    // Pull later entries of the run back over the hole.
+    for (size_t j = (i + 1) & (UDP_TABLE - 1); table[j] >= 0; j = (j + 1) & (UDP_TABLE - 1)) {
+        size_t home = slot_of(sess[table[j]].token);
+        // Move j into i unless its home lies cyclically in (i, j].
+        if (((j - home) & (UDP_TABLE - 1)) >= ((j - i) & (UDP_TABLE - 1))) {
+            table[i] = table[j];
+            table[j] = -1;
+            i = j;
+        }
+    }
+
+    if (!u->finished) stats_add(STAT_ABANDONED, 1);
+    session_end(&u->s);
+    u->token = 0;
+    free_list[n_free++] = (int32_t)(u - sess);
+}
+
+static void expire(uint64_t now) {
+    for (int32_t k = 0; k < UDP_MAX_SESSIONS; k++) {
+        if (sess[k].token && sess[k].expire_ns <= now) drop(&sess[k]);
+    }
+}
+
+// ---------- requests ----------
+
+// Handle one datagram; returns the reply length written to out (0 = no reply).
+static size_t handle(const unsigned char *in, size_t len, const struct sockaddr_in *from,
+                     unsigned char *out, uint64_t now)
+{
+    uint8_t op;
+    uint32_t seq;
+    uint64_t token;
+    if (udp_get_hdr(in, len, &op, &seq, &token) < 0 || token == 0) return 0;
+
+    struct udp_sess *u = lookup(token);
+    if (u && (u->peer.sin_addr.s_addr != from->sin_addr.s_addr ||
+              u->peer.sin_port != from->sin_port)) {
+        return 0;   // someone else's game
+    }
+    if (u && seq == u->last_seq) {
+        memcpy(out, u->reply, u->reply_len);    // lost reply: say it again
+        return u->reply_len;
+    }
+
+    unsigned char *p = out + UDP_HDR;
+    udp_put_hdr(out, UDP_REPLY, seq, token);
+
+    if (!u) {
+        if (op != UDP_HELLO || seq != 1) {
+            return UDP_HDR + v2_encode_status(p, V2_ST_GAME_OVER);
+        }
+        u = insert(token);
+        if (!u) return 0;   // full; the client's retries may find room
+        u->peer = *from;
+        if (session_start(&u->s, udp_ix, rand() % num_words, udp_evil) < 0) {
+            u->finished = 1;
+            drop(u);
+            return 0;
+        }
+        stats_add(STAT_GAMES, 1);
+        const struct game *g = &u->s.g;
+        p += v2_encode_board(p, g->masked, g->incorrect, g->word_len, g->num_incorrect);
+    } else if (seq != u->last_seq + 1) {
+        return 0;           // stale or out of order
+    } else if (op == UDP_BYE) {
+        u->last_seq = seq;
+        drop(u);
+        return UDP_HDR;
+    } else if (u->finished) {
+        p += v2_encode_status(p, V2_ST_GAME_OVER);
+    } else if (op == UDP_HINT) {
+        stats_add(STAT_HINTS, 1);
+        int best = session_hint(&u->s, udp_ix);
+        p += v2_encode_hint(p, best > 0 ? best : 0);
+    } else if (op == UDP_GUESS && len > UDP_HDR) {
+        unsigned char letter = (unsigned char)tolower(in[UDP_HDR]);
+        uint64_t guess_at = stats_clock();
+        enum guess_result res = session_guess(&u->s, letter);
+        const struct game *g = &u->s.g;
+        stats_add(STAT_GUESSES, 1);
+        if (game_won(g) || game_lost(g)) {
+            p += v2_encode_game_end(p, game_secret(g), game_won(g));
+            stats_add(game_won(g) ? STAT_WON : STAT_LOST, 1);
+            u->finished = 1;
+        } else if (res == GUESS_MISS) {
+            p += v2_encode_miss(p, letter);
+        } else {
+            p += v2_encode_reveal(p, letter, res == GUESS_HIT ? game_reveal_mask(g, letter) : 0);
+        }
+        stats_record(HIST_GUESS, stats_clock() - guess_at);
+    } else {
+        return 0;
+    }
+
+    u->last_seq  = seq;
+    u->expire_ns = now + (u->finished ? UDP_LINGER_SECS : UDP_IDLE_SECS) * 1000000000ull;
+    u->reply_len = (uint16_t)(p - out);
+    memcpy(u->reply, out, u->reply_len);
+    return u->reply_len;
+}
+
+void udp_run(int fd, const struct word_index *ix, int evil) {
+    udp_ix   = ix;
+    udp_evil = evil;
+    sess      = calloc(UDP_MAX_SESSIONS, sizeof(*sess));
+    table     = malloc(UDP_TABLE * sizeof(*table));
+    free_list = malloc(UDP_MAX_SESSIONS * sizeof(*free_list));
+    if (!sess || !table || !free_list) {
+        perror("udp: alloc");
+        _exit(1);
+    }
+    memset(table, 0xff, UDP_TABLE * sizeof(*table));
+    for (int32_t k = UDP_MAX_SESSIONS - 1; k >= 0; k--) free_list[n_free++] = k;
+    srand((unsigned int)(time(NULL) ^ (getpid() << 16)));
+
+    static unsigned char       in[UDP_BATCH][UDP_DGRAM_MAX];
+    static unsigned char       out[UDP_BATCH][UDP_REPLY_MAX];
+    static struct sockaddr_in  from[UDP_BATCH];
+    static struct iovec        in_iov[UDP_BATCH], out_iov[UDP_BATCH];
+    static struct mmsghdr      in_msg[UDP_BATCH], out_msg[UDP_BATCH];
+    for (int i = 0; i < UDP_BATCH; i++) {
+        in_iov[i].iov_base = in[i];
+        in_iov[i].iov_len  = sizeof(in[i]);
+    }
+
+    uint64_t next_sweep = now_ns() + 1000000000ull;
+    for (;;) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, 1000) < 0 && errno != EINTR) {
+            perror("udp: poll");
+            _exit(1);
+        }
+
+        // Drain whatever has queued up, a batch per syscall each way.
+        for (;;) {
+            for (int i = 0; i < UDP_BATCH; i++) {
+                memset(&in_msg[i].msg_hdr, 0, sizeof(in_msg[i].msg_hdr));
+                in_msg[i].msg_hdr.msg_name    = &from[i];
+                in_msg[i].msg_hdr.msg_namelen = sizeof(from[i]);
+                in_msg[i].msg_hdr.msg_iov     = &in_iov[i];
+                in_msg[i].msg_hdr.msg_iovlen  = 1;
+            }
+            int n = recvmmsg(fd, in_msg, UDP_BATCH, MSG_DONTWAIT, NULL);
+            if (n <= 0) break;
+
+            uint64_t now = now_ns();
+            int m = 0;
+            for (int i = 0; i < n; i++) {
+                size_t len = handle(in[i], in_msg[i].msg_len, &from[i], out[m], now);
+                if (len == 0) continue;
+                out_iov[m].iov_base = out[m];
+                out_iov[m].iov_len  = len;
+                memset(&out_msg[m].msg_hdr, 0, sizeof(out_msg[m].msg_hdr));
+                out_msg[m].msg_hdr.msg_name    = &from[i];
+                out_msg[m].msg_hdr.msg_namelen = sizeof(from[i]);
+                out_msg[m].msg_hdr.msg_iov     = &out_iov[m];
+                out_msg[m].msg_hdr.msg_iovlen  = 1;
+                m++;
+            }
+            // A reply that does not go out is a lost datagram; the client
+            // retransmits and gets the cached copy.
+            for (int sent = 0; sent < m; ) {
+                int k = sendmmsg(fd, out_msg + sent, (unsigned int)(m - sent), 0);
+                if (k <= 0) break;
+                sent += k;
+            }
+            if (n < UDP_BATCH) break;
+        }
+
+        uint64_t now = now_ns();
+        if (now >= next_sweep) {
+            expire(now);
+            next_sweep = now + 1000000000ull;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef HANGMAN_UDP_H
+#define HANGMAN_UDP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_index.h"
+
+// UDP transport for solo games: one datagram per request, one per reply,
+// no connection to set up or tear down.
+//
+//   request: [op][seq: u32][token: u64][payload]
+//   reply:   [UDP_REPLY][seq][token][v2 frames, with delta boards]
+//
+// Integers are little-endian. The client picks a random 64-bit token per
+// game and numbers its requests 1, 2, 3, ... starting with UDP_HELLO. The
+// reply doubles as the ack: a client that hears nothing within
+// UDP_RETRANSMIT_MS sends the same request again, and the server answers
+// a repeat of the last seq from its cached reply without replaying the
+// guess. Anything older or further ahead is dropped, so at most one
+// request per game is ever in flight. A request for a token the server
+// does not know (expired, or never said hello) gets a GAME_OVER status.
+//
+// One process serves every UDP game with recvmmsg/sendmmsg, UDP_BATCH
+// datagrams per call.
+
+#define UDP_HDR             13
+#define UDP_DGRAM_MAX       512
+#define UDP_BATCH           64
+#define UDP_MAX_SESSIONS    65536
+#define UDP_IDLE_SECS       30      // drop a game nobody has touched
+#define UDP_LINGER_SECS     5       // keep a finished game for retransmits
+#define UDP_RETRANSMIT_MS   200
+#define UDP_RETRIES         10
+
+enum udp_op {
+    UDP_HELLO = 1,      // start a game; reply is the first board
+    UDP_GUESS = 2,      // payload: letter
+    UDP_HINT  = 3,
+    UDP_BYE   = 4,      // done with the token; reply is empty
+    UDP_REPLY = 0x80,
+};
+
+static inline void udp_put_hdr(unsigned char *p, uint8_t op, uint32_t seq, uint64_t token) {
+    p[0] = op;
+    for (int i = 0; i < 4; i++) p[1 + i] = (unsigned char)(seq >> (8 * i));
+    for (int i = 0; i < 8; i++) p[5 + i] = (unsigned char)(token >> (8 * i));
+}
+
+// 0 on success, -1 if len is too short for a header.
+static inline int udp_get_hdr(const unsigned char *p, size_t len,
+                              uint8_t *op, uint32_t *seq, uint64_t *token)
+{
+    if (len < UDP_HDR) return -1;
+    *op  = p[0];
+    *seq = 0;
+    for (int i = 0; i < 4; i++) *seq |= (uint32_t)p[1 + i] << (8 * i);
+    *token = 0;
+    for (int i = 0; i < 8; i++) *token |= (uint64_t)p[5 + i] << (8 * i);
+    return 0;
+}
+
+// Serve UDP games on the bound socket fd. Never returns.
+void udp_run(int fd, const struct word_index *ix, int evil);
+
+#endif
@@ -0,0 +1,53 @@
+#include "hangman_upgrade.h"
+
+#include <sys/socket.h>
+#include <string.h>
+
+int up_send(int fd, const void *msg, size_t len, const int *fds, int nfds) {
+    struct iovec iov = { .iov_base = (void *)msg, .iov_len = len };
+    union {
+        char           buf[CMSG_SPACE(UP_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+
+    struct msghdr mh = {
+        .msg_iov    = &iov,
+        .msg_iovlen = 1,
+    };
+    if (nfds > 0) {
+        mh.msg_control    = ctl.buf;
+        mh.msg_controllen = CMSG_SPACE((size_t)nfds * sizeof(int));
+        struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type  = SCM_RIGHTS;
+        c->cmsg_len   = CMSG_LEN((size_t)nfds * sizeof(int));
+        memcpy(CMSG_DATA(c), fds, (size_t)nfds * sizeof(int));
+    }
+    return sendmsg(fd, &mh, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+ssize_t up_recv(int fd, void *msg, size_t cap, int *fds, int *nfds, int flags) {
+    struct iovec iov = { .iov_base = msg, .iov_len = cap };
+    union {
+        char           buf[CMSG_SPACE(UP_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+
+    struct msghdr mh = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = ctl.buf,
+        .msg_controllen = sizeof(ctl.buf),
+    };
+    *nfds = 0;
+    ssize_t n = recvmsg(fd, &mh, flags | MSG_CMSG_CLOEXEC);
+    if (n <= 0) return n;
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+    if (c && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+        *nfds = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(fds, CMSG_DATA(c), (size_t)*nfds * sizeof(int));
+    }
+    return n;
+}
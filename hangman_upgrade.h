@@ -0,0 +1,86 @@
+#ifndef HANGMAN_UPGRADE_H
+#define HANGMAN_UPGRADE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "hangman_stats.h"
+
+// Hot upgrade (SIGUSR2 to the parent): the running server starts the
+// binary now at its own path as a sibling, with one end of a Unix
+// SOCK_SEQPACKET pair passed as --upgrade-fd. Everything crosses that
+// channel as messages with the fds alongside (SCM_RIGHTS):
+//
+//   old -> new  UP_LISTENERS  TCP, Unix, metrics and UDP sockets, the room
+//                             hub's control socket and watch counts, the
+//                             hub and UDP pids and pidfds, and which stats
+//                             slots are still in use
+//   new -> old  UP_READY      dictionary, index and workers are up
+//   old -> new  UP_SESSION    one worker game each, fd and state
+//   old -> new  UP_END        nothing more
+//
+// The listening sockets never close, so connections arriving meanwhile
+// wait in the backlog instead of being refused. The old process stops
+// accepting on UP_READY, and the new one starts right after sending it.
+// Games on worker threads move mid-game; the old process then drains like
+// it does on SIGTERM, except that it leaves the hub and the UDP process
+// running.
+//
+// The new server adopts those two rather than starting its own, so rooms,
+// races, tournaments, the match queue, spectators, the leaderboard and
+// UDP games all carry on. They are not its children, so it watches their
+// pidfds to notice them exit and signals them when it drains; they keep
+// the old binary and dictionary until the server is restarted. Games on
+// forked children do not move either; each finishes on the old binary.
+
+// Bump when any message layout changes, here or in the hub's control
+// messages (an adopted hub is the old binary).
+#define UP_VERSION   4
+#define UP_MAX_FDS   8
+#define UP_MSG_MAX   4096
+
+enum up_type {
+    UP_LISTENERS = 'L',
+    UP_READY     = 'R',
+    UP_SESSION   = 'S',
+    UP_END       = 'E',
+};
+
+// Which of the listeners an UP_LISTENERS message carries; the fds follow
+// in this order.
+enum {
+    UP_HAS_TCP     = 1 << 0,
+    UP_HAS_UNIX    = 1 << 1,
+    UP_HAS_METRICS = 1 << 2,
+    UP_HAS_UDP     = 1 << 3,
+    UP_HAS_HUB     = 1 << 4,    // control socket
+    UP_HAS_HUB_MAP = 1 << 5,    // watch counts, see hub_setup()
+    UP_HAS_HUB_PID = 1 << 6,    // pidfd of the hub
+    UP_HAS_UDP_PID = 1 << 7,    // pidfd of the UDP process
+};
+
+struct up_listeners {
+    uint8_t type;                       // UP_LISTENERS
+    uint8_t version;                    // UP_VERSION; the new side gives up on a mismatch
+    uint8_t has;                        // UP_HAS_* bits
+    pid_t   pid;                        // the old server
+    pid_t   hub_pid;                    // its room hub, if UP_HAS_HUB
+    pid_t   udp_pid;                    // its UDP process, 0 = none running
+    pid_t   slot_owner[STATS_SLOTS];    // old writers, 0 = free
+};
+
+struct up_ready {
+    uint8_t type;                       // UP_READY
+    pid_t   pid;                        // the new server
+};
+
+// Send one message with nfds descriptors. 0 on success, -1 on error.
+int up_send(int fd, const void *msg, size_t len, const int *fds, int nfds);
+
+// Receive one message (flags as for recvmsg). The descriptors that came
+// with it land in fds[0..*nfds), close-on-exec. Returns the message
+// length, 0 if the peer is gone, -1 on error.
+ssize_t up_recv(int fd, void *msg, size_t cap, int *fds, int *nfds, int flags);
+
+#endif
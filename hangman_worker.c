@@ -0,0 +1,1005 @@
+#define _GNU_SOURCE     // pthread_setaffinity_np
+#include "hangman_worker.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hangman_capture.h"
+#include "hangman_flight.h"
+#include "hangman_game.h"
+#include "hangman_leader.h"
+#include "hangman_log.h"
+#include "hangman_match.h"
+#include "hangman_proto.h"
+#include "hangman_room.h"
+#include "hangman_sesstab.h"
+#include "hangman_stats.h"
+#include "hangman_trace.h"
+#include "hangman_upgrade.h"
+
+#define WORKER_EVENTS   64
+#define WORKER_BUDGET   16      // frames per connection per wakeup
+#define WS_IN_MAX       (2 * (1 + MSG_MAX))
+#define WS_OUT_MAX      2048
+#define WS_REPLY_MAX    GAME_END_MAX    // largest reply to one frame
+#define LAT_BUCKETS     64              // log2 of stats_clock() ticks
+
+enum mail_kind {
+    MAIL_CONN,      // a fresh connection from the accept loop
+    MAIL_SESSION,   // a game moved from another worker
+    MAIL_SHED,      // from the balancer: move about rate guesses/s to worker to
+    MAIL_RESUME,    // a game handed over by the old server (hot upgrade)
+    MAIL_EXPORT,    // hot upgrade: send every game down fd from now on
+};
+
+struct mail {
+    struct mail        *next;
+    enum mail_kind      kind;
+    int                 fd;
+    int32_t             id;
+    struct session_pack pack;
+    uint8_t             playing, finished, closing, v2, features;
+    int32_t             tab;
+    char                player[LB_NAME_MAX + 1];
+    uint64_t            start_ns, bytes_sent;
+    int                 to;
+    uint64_t            rate;
+    size_t              in_len, out_len;
+    unsigned char      *carry;      // MAIL_RESUME: in_len + out_len buffered bytes
+    struct cap_buf      cap;        // MAIL_SESSION: the trace so far
+};
+
+struct wsess {
+    int            fd;              // -1 = free slot
+    int32_t        id;
+    int            playing, finished, closing;
+    uint8_t        v2, features;
+    int32_t        tab;             // session table slot, -1 = not resumable
+    uint32_t       events;
+    char           player[LB_NAME_MAX + 1];
+    uint64_t       welcome_at, start_ns, bytes_sent;
+    uint64_t       here_since, guesses_here;    // rate on this worker
+    struct cap_buf cap;
+    struct session s;
+    size_t         in_len, out_len;
+    unsigned char  in[WS_IN_MAX];
+    unsigned char  out[WS_OUT_MAX];
+};
+
+// One game on the upgrade channel: this, then in_len bytes of unread
+// input and out_len bytes of unsent output. The fd travels alongside.
+struct handoff {
+    uint8_t             type;       // UP_SESSION
+    uint8_t             playing, finished, closing, v2, features;
+    uint16_t            in_len, out_len;
+    int32_t             id, tab;
+    char                player[LB_NAME_MAX + 1];
+    uint64_t            start_ns, bytes_sent;
+    struct session_pack pack;
+};
+
+_Static_assert(sizeof(struct handoff) + WS_IN_MAX + WS_OUT_MAX <= UP_MSG_MAX,
+               "a handed-off game must fit one upgrade message");
+
+struct worker {
+    _Alignas(64) struct mail *mailbox;  // pushed by anyone, emptied by the owner
+    _Alignas(64) int          assigned; // sessions placed here (atomic)
+    int                       shed_pending;
+
+    // Cumulative, written by the owner only; the balancer diffs them.
+    _Alignas(64) uint64_t     busy_ns;
+    uint64_t                  wakeups, ready, guesses;
+    uint64_t                  lat[LAT_BUCKETS];
+
+    // Owner only.
+    int                       index, epfd, evfd, slot, n_live;
+    int                       export_fd;    // upgrade channel once exporting, else -1
+    unsigned int              seed;
+    struct wsess             *pool;
+    int                      *free_idx;
+    int                       n_free;
+};
+
+static struct worker            workers[WORKER_MAX];
+static int                      n_workers;
+static int                      w_hub_fd, w_evil, w_replay;
+static const struct word_index *w_ix;
+static int                      live;       // sessions anywhere (atomic)
+static int32_t                  next_id;    // accept loop only
+static unsigned int             place_rr;   // accept loop only
+
+static void bump(uint64_t *p, uint64_t n) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// ---------- mailbox ----------
+
+static void mail_push(struct worker *w, struct mail *m) {
+    struct mail *head = __atomic_load_n(&w->mailbox, __ATOMIC_RELAXED);
+    do {
+        m->next = head;
+    } while (!__atomic_compare_exchange_n(&w->mailbox, &head, m, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    uint64_t one = 1;
+    if (write(w->evfd, &one, sizeof(one)) < 0) {
+        // Only fails if the counter would overflow; the worker is awake.
+    }
+}
+
+// Everything queued so far, oldest first.
+static struct mail *mail_take(struct worker *w) {
+    struct mail *m = __atomic_exchange_n(&w->mailbox, NULL, __ATOMIC_ACQUIRE);
+    struct mail *fifo = NULL;
+    while (m) {
+        struct mail *next = m->next;
+        m->next = fifo;
+        fifo = m;
+        m = next;
+    }
+    return fifo;
+}
+
+// ---------- output ----------
+//
+// Replies are appended to the session's buffer and sent once per wakeup.
+// Frame handling stops while less than WS_REPLY_MAX is free.
+
+// One frame to the player, as send_player does for a child.
+// Queue a frame without capturing it; see put_token.
+static void put_uncaptured(struct wsess *s, const unsigned char *p, size_t len) {
+    fr_record(FR_SENT, p, len);
+    memcpy(s->out + s->out_len, p, len);
+    s->out_len    += len;
+    s->bytes_sent += len;
+}
+
+static void put(struct wsess *s, const unsigned char *p, size_t len) {
+    cap_buf_frame(&s->cap, CAP_OUT, p, len);
+    put_uncaptured(s, p, len);
+}
+
+static int watched(const struct wsess *s) {
+    return hub_session_watched((uint32_t)s->id);
+}
+
+// Copy a v1 frame to the session's spectators; callers check watched().
+static void mirror(const struct wsess *s, const unsigned char *pkt, size_t len) {
+    hub_publish(w_hub_fd, (uint32_t)s->id, pkt, len);
+}
+
+// Spectators always get v1.
+static void put_message(struct wsess *s, const char *msg) {
+    unsigned char pkt[MESSAGE_PKT_MAX];
+    if (!s->v2) {
+        size_t len = encode_message(pkt, msg);
+        if (watched(s)) mirror(s, pkt, len);
+        put(s, pkt, len);
+        return;
+    }
+    if (watched(s)) mirror(s, pkt, encode_message(pkt, msg));
+    unsigned char v2[V2_TEXT_MAX];
+    size_t len = strlen(msg);
+    put(s, v2, v2_encode_text(v2, msg, len < MSG_MAX ? len : MSG_MAX));
+}
+
+static void put_game_over(struct wsess *s) {
+    if (!s->v2) {
+        put_message(s, "Game Over!");
+        return;
+    }
+    unsigned char pkt[V2_STATUS_MAX];
+    put(s, pkt, v2_encode_status(pkt, V2_ST_GAME_OVER));
+}
+
+static void mirror_board(struct wsess *s) {
+    const struct game *g = &s->s.g;
+    unsigned char pkt[GAME_STATE_MAX];
+    mirror(s, pkt, encode_game_state(pkt, g->masked, g->incorrect, g->word_len, g->num_incorrect));
+}
+
+static void put_board(struct wsess *s) {
+    const struct game *g = &s->s.g;
+    unsigned char pkt[V2_BOARD_MAX > GAME_STATE_MAX ? V2_BOARD_MAX : GAME_STATE_MAX];
+    if (watched(s)) mirror_board(s);
+    put(s, pkt, s->v2 ? v2_encode_board(pkt, g->masked, g->incorrect, g->word_len, g->num_incorrect)
+                      : encode_game_state(pkt, g->masked, g->incorrect, g->word_len, g->num_incorrect));
+}
+
+static void put_guess(struct wsess *s, unsigned char letter, enum guess_result res) {
+    if (!s->v2 || !(s->features & V2_F_DELTA)) {
+        put_board(s);
+        return;
+    }
+    if (watched(s)) mirror_board(s);
+    unsigned char pkt[V2_DELTA_MAX];
+    put(s, pkt, res == GUESS_MISS ? v2_encode_miss(pkt, letter)
+              : v2_encode_reveal(pkt, letter, res == GUESS_HIT ? game_reveal_mask(&s->s.g, letter) : 0));
+}
+
+static void put_hint(struct wsess *s, int best) {
+    char hint_msg[] = "Hint: none";
+    if (best > 0) {
+        hint_msg[6] = (char)best;
+        hint_msg[7] = '\0';
+    }
+    if (!s->v2) {
+        put_message(s, hint_msg);
+        return;
+    }
+    if (watched(s)) {
+        unsigned char msg[MESSAGE_PKT_MAX];
+        mirror(s, msg, encode_message(msg, hint_msg));
+    }
+    unsigned char pkt[V2_HINT_MAX];
+    put(s, pkt, v2_encode_hint(pkt, best));
+}
+
+// The token goes to the player alone: a spectator holding it could take
+// the game over, and a replayed trace has no token to compare.
+static void put_token(struct wsess *s, uint64_t token) {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "Resume token: %016llx", (unsigned long long)token);
+    unsigned char pkt[V2_TEXT_MAX];
+    put_uncaptured(s, pkt, s->v2 ? v2_encode_text(pkt, msg, strlen(msg)) : encode_message(pkt, msg));
+}
+
+// Returns the bytes put, for the board_sent probe.
+static size_t put_game_end(struct wsess *s) {
+    const struct game *g = &s->s.g;
+    unsigned char pkt[GAME_END_MAX];
+    size_t len;
+    if (!s->v2) {
+        len = encode_game_end(pkt, game_secret(g), game_won(g));
+        if (watched(s)) mirror(s, pkt, len);
+    } else {
+        if (watched(s)) mirror(s, pkt, encode_game_end(pkt, game_secret(g), game_won(g)));
+        len = v2_encode_game_end(pkt, game_secret(g), game_won(g));
+    }
+    put(s, pkt, len);
+    return len;
+}
+
+// 0, or -1 if the connection failed.
+static int flush(struct wsess *s) {
+    size_t done = 0;
+    while (done < s->out_len) {
+        ssize_t n = send(s->fd, s->out + done, s->out_len - done, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    memmove(s->out, s->out + done, s->out_len - done);
+    s->out_len -= done;
+    return 0;
+}
+
+// ---------- sessions ----------
+
+static struct wsess *sess_alloc(struct worker *w, int fd) {
+    if (w->n_free == 0) return NULL;
+    struct wsess *s = &w->pool[w->free_idx[--w->n_free]];
+    memset(s, 0, offsetof(struct wsess, in));
+    s->fd  = fd;
+    s->tab = -1;
+    w->n_live++;
+    return s;
+}
+
+// Give the slot back. The fd is the caller's business.
+static void sess_release(struct worker *w, struct wsess *s) {
+    s->fd = -1;
+    w->free_idx[w->n_free++] = (int)(s - w->pool);
+    w->n_live--;
+    __atomic_sub_fetch(&w->assigned, 1, __ATOMIC_RELAXED);
+}
+
+static void sess_close(struct worker *w, struct wsess *s) {
+    if (s->playing) {
+        if (!s->finished) stats_add(STAT_ABANDONED, 1);
+        stats_record(HIST_GAME_BYTES, s->bytes_sent);
+        session_end(&s->s);
+    }
+    if (s->tab >= 0) sesstab_release(s->tab, 1);
+    if (watched(s)) hub_session_end(w_hub_fd, (uint32_t)s->id);
+    char name[32];
+    snprintf(name, sizeof(name), "%d-%d", (int)getpid(), (int)s->id);
+    if (cap_buf_finish(&s->cap, name) < 0) perror("capture");
+    cap_buf_free(&s->cap);
+    // Explicitly: a copy of the fd in a forked process would keep it registered.
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    sess_release(w, s);
+    __atomic_sub_fetch(&live, 1, __ATOMIC_RELAXED);
+}
+
+static int frame_ready(const struct wsess *s) {
+    return s->in_len > 0 && s->in_len >= 1 + (size_t)s->in[0];
+}
+
+static void set_interest(struct worker *w, struct wsess *s) {
+    int room = WS_OUT_MAX - s->out_len >= WS_REPLY_MAX;
+    uint32_t want = 0;
+    if (!s->closing && room) want |= EPOLLIN;
+    // A frame left over from an exhausted budget: writable fires at once.
+    if (s->out_len || (!s->closing && room && frame_ready(s))) want |= EPOLLOUT;
+    if (want == s->events) return;
+    struct epoll_event ev = { .events = want, .data.ptr = s };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_MOD, s->fd, &ev) == 0) s->events = want;
+}
+
+// The hub took its own copy of the connection (or failed to, rc < 0).
+// Returns -1 once the session is gone.
+static int to_hub(struct worker *w, struct wsess *s, int rc, const char *what) {
+    if (rc < 0) {
+        perror(what);
+        put_game_over(s);
+        s->closing = 1;
+        return 0;
+    }
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    cap_buf_free(&s->cap);      // not a solo game: never written
+    sess_release(w, s);
+    __atomic_sub_fetch(&live, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+// The start frame, as handle_client reads it. -1 once the session is gone.
+static int handle_start(struct worker *w, struct wsess *s, const unsigned char *frame) {
+    char buf[MSG_MAX + 1];
+    size_t len = frame[0];
+    memcpy(buf, frame + 1, len);
+    buf[len] = '\0';
+    const char *cmd = buf;
+    fr_record(FR_START, cmd, len);
+    cap_buf_frame(&s->cap, CAP_IN, frame, 1 + len);
+
+    if (len > 0 && cmd[0] == START_V2) {
+        s->v2       = 1;
+        s->features = len > 1 ? (uint8_t)cmd[1] : 0;
+        size_t skip = len > 1 ? 2 : 1;
+        cmd += skip;
+        len -= skip;
+    }
+    stats_record(HIST_START, stats_clock() - s->welcome_at);
+    TRACE3(start, s->id, len, len ? cmd[0] : 0);
+
+    if (s->v2 && start_for_hub(cmd, len)) {
+        put_message(s, V2_SOLO_ONLY);
+        put_game_over(s);
+        s->closing = 1;
+        return 0;
+    }
+
+    if (len > 0) {
+        switch (cmd[0]) {
+        case START_JOIN_ROOM:
+            return to_hub(w, s, room_handoff(w_hub_fd, (uint32_t)strtoul(cmd + 1, NULL, 10), s->fd),
+                          "room_handoff");
+        case START_MATCH:
+            return to_hub(w, s, hub_match(w_hub_fd, len > 1 ? atoi(cmd + 1) : MM_DEFAULT_RATING, s->fd),
+                          "hub_match");
+        case START_TOURNEY:
+            return to_hub(w, s, hub_tourney(w_hub_fd, (uint32_t)strtoul(cmd + 1, NULL, 10), s->fd),
+                          "hub_tourney");
+        case START_RANK:
+            return to_hub(w, s, hub_rank(w_hub_fd, cmd + 1, s->fd), "hub_rank");
+        case START_STATS:
+            return to_hub(w, s, hub_stats(w_hub_fd, s->fd), "hub_stats");
+        case START_WATCH:
+            if (cmd[1] == FEED_ROOM || cmd[1] == FEED_SESSION) {
+                return to_hub(w, s, hub_watch(w_hub_fd, cmd[1], (uint32_t)strtoul(cmd + 2, NULL, 10), s->fd),
+                              "hub_watch");
+            }
+            break;
+        case START_PLAYER:
+            snprintf(s->player, sizeof(s->player), "%.*s", LB_NAME_MAX, cmd + 1);
+            break;
+        }
+    }
+
+    int word_idx = (int)((unsigned int)rand_r(&w->seed) % (unsigned int)num_words);
+    struct session_pack pack;
+    int unpack = 0;
+    memset(&pack, 0, sizeof(pack));
+    if (len > 0 && cmd[0] == START_REPLAY) {
+        long want = strtol(cmd + 1, NULL, 10);
+        if (!w_replay || want < 0 || want >= num_words) {
+            put_game_over(s);
+            s->closing = 1;
+            return 0;
+        }
+        if (replay_differs(cmd, num_words, w_evil)) {
+            put_message(s, REPLAY_CONFIG_DIFFERS);
+            put_game_over(s);
+            s->closing = 1;
+            return 0;
+        }
+        word_idx = (int)want;
+        // A replayed trace of a resumed game names the state it took up.
+        int misses = replay_resumed(cmd, &pack.guessed, pack.incorrect, MAX_INCORRECT - 1);
+        if (misses < 0) {
+            put_game_over(s);
+            s->closing = 1;
+            return 0;
+        }
+        if (pack.guessed) {
+            pack.word_idx      = word_idx;
+            pack.num_incorrect = (unsigned char)misses;
+            pack.evil          = (unsigned char)w_evil;
+            unpack = 1;
+        }
+    }
+    uint64_t token = 0;
+    if (len > 1 && cmd[0] == START_RESUME) {
+        token  = strtoull(cmd + 1, NULL, 16);
+        s->tab = sesstab_enabled() ? sesstab_adopt(token, &pack) : -1;
+        if (s->tab < 0) {
+            put_message(s, "No game to resume");
+            put_game_over(s);
+            s->closing = 1;
+            return 0;
+        }
+        unpack = 1;
+    }
+    if (unpack) {
+        if (session_unpack(&s->s, &pack, w_ix) < 0) {
+            perror("session_unpack");
+            session_end(&s->s);
+            s->closing = 1;
+            return 0;   // sess_close leaves it resumable
+        }
+    } else {
+        if (session_start(&s->s, w_ix, word_idx, w_evil) < 0) {
+            perror("session_start");
+            session_end(&s->s);
+            s->closing = 1;
+            return 0;
+        }
+        session_pack(&s->s, &pack);
+        if (len > 0 && cmd[0] == START_RESUME && sesstab_enabled() &&
+            (s->tab = sesstab_claim(&token)) >= 0) {
+            sesstab_save(s->tab, &s->s);
+        }
+    }
+    cap_buf_word(&s->cap, &pack, (uint32_t)num_words);
+    if (s->tab >= 0) put_token(s, token);
+    s->playing    = 1;
+    s->start_ns   = now_ns();
+    s->here_since = s->start_ns;
+    stats_add(STAT_GAMES, 1);
+    put_board(s);
+    return 0;
+}
+
+// One complete frame. Returns 1 for an answered guess, 0 otherwise, -1
+// once the session is gone.
+static int handle_frame(struct worker *w, struct wsess *s, const unsigned char *frame) {
+    if (!s->playing) return handle_start(w, s, frame);
+
+    if (frame[0] == 0) {
+        stats_add(STAT_HINTS, 1);
+        fr_record(FR_HINT, NULL, 0);
+        cap_buf_frame(&s->cap, CAP_IN, frame, 1);
+        int best = session_hint(&s->s, w_ix);
+        if (best < 0) {
+            perror("session_hint");
+            s->closing = 1;
+            return 0;
+        }
+        put_hint(s, best);
+        return 0;
+    }
+    if (frame[0] != 1) {
+        // Not a guess; ignored like handle_client does.
+        fr_record(FR_OTHER, NULL, frame[0]);
+        cap_buf_frame(&s->cap, CAP_IN, frame, 1 + (size_t)frame[0]);
+        return 0;
+    }
+
+    fr_record(FR_GUESS, frame + 1, 1);
+    cap_buf_frame(&s->cap, CAP_IN, frame, 2);
+    TRACE2(guess, s->id, frame[1]);
+    unsigned char letter = (unsigned char)tolower(frame[1]);
+    enum guess_result res = session_guess(&s->s, letter);
+    const struct game *g = &s->s.g;
+    stats_add(STAT_GUESSES, 1);
+    s->guesses_here++;
+    bump(&w->guesses, 1);
+    TRACE3(reveal, s->id, (int)res, g->num_incorrect);
+
+    if (game_won(g) || game_lost(g)) {
+        if (s->tab >= 0) sesstab_release(s->tab, 0);
+        s->tab = -1;
+        size_t len = put_game_end(s);
+        TRACE2(board_sent, s->id, len);
+        TRACE2(game_end, s->id, game_won(g));
+        stats_add(game_won(g) ? STAT_WON : STAT_LOST, 1);
+        s->finished = 1;
+        s->closing  = 1;
+        if (s->player[0]) {
+            hub_result(w_hub_fd, s->player, game_won(g), g->num_incorrect, now_ns() - s->start_ns);
+        }
+    } else {
+        if (s->tab >= 0) sesstab_save(s->tab, &s->s);
+        uint64_t sent_before = s->bytes_sent;
+        put_guess(s, letter, res);
+        TRACE2(board_sent, s->id, s->bytes_sent - sent_before);
+    }
+    return 1;
+}
+
+// Read and answer what the connection has, up to WORKER_BUDGET frames so
+// one busy connection cannot hold up the rest of the batch.
+static void serve(struct worker *w, struct wsess *s, uint64_t woke) {
+    int answered = 0, budget = WORKER_BUDGET;
+    fr_set_session((uint32_t)s->id);
+    for (;;) {
+        while (budget > 0 && !s->closing && WS_OUT_MAX - s->out_len >= WS_REPLY_MAX &&
+               frame_ready(s)) {
+            size_t flen = 1 + (size_t)s->in[0];
+            int r = handle_frame(w, s, s->in);
+            if (r < 0) return;
+            answered += r;
+            budget--;
+            memmove(s->in, s->in + flen, s->in_len - flen);
+            s->in_len -= flen;
+        }
+        if (budget == 0 || s->closing || WS_OUT_MAX - s->out_len < WS_REPLY_MAX ||
+            s->in_len == WS_IN_MAX) {
+            break;
+        }
+        ssize_t n = recv(s->fd, s->in + s->in_len, WS_IN_MAX - s->in_len, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) break;
+        if (n <= 0) {
+            sess_close(w, s);
+            return;
+        }
+        s->in_len += (size_t)n;
+    }
+
+    if (flush(s) < 0) {
+        sess_close(w, s);
+        return;
+    }
+    if (answered) {
+        // Wakeup to reply, so time spent behind other connections counts.
+        uint64_t lat = stats_clock() - woke;
+        for (int i = 0; i < answered; i++) stats_record(HIST_GUESS, lat);
+        bump(&w->lat[63 - __builtin_clzll(lat | 1)], (uint64_t)answered);
+    }
+    if (s->closing && s->out_len == 0) {
+        sess_close(w, s);
+        return;
+    }
+    set_interest(w, s);
+}
+
+// ---------- migration ----------
+
+static void adopt(struct worker *w, struct mail *m) {
+    struct wsess *s = sess_alloc(w, m->fd);
+    if (!s) {
+        // Cannot happen while WORKER_MAX_SESSIONS bounds every pool.
+        cap_buf_free(&m->cap);
+        close(m->fd);
+        __atomic_sub_fetch(&w->assigned, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&live, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    s->id         = m->id;
+    s->here_since = now_ns();
+    fr_set_session((uint32_t)s->id);
+
+    if (m->kind == MAIL_CONN) {
+        fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) | O_NONBLOCK);
+        int one = 1;
+        (void)setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        cap_buf_begin(&s->cap);
+        put_message(s, "Welcome to Hangman");
+        s->welcome_at = stats_clock();
+    } else {
+        s->playing    = m->playing;
+        s->finished   = m->finished;
+        s->closing    = m->closing;
+        s->v2         = m->v2;
+        s->features   = m->features;
+        s->tab        = m->tab;
+        s->start_ns   = m->start_ns;
+        s->bytes_sent = m->bytes_sent;
+        s->cap        = m->cap;     // MAIL_SESSION only; zero otherwise
+        memcpy(s->player, m->player, sizeof(s->player));
+        if (m->carry) {
+            memcpy(s->in, m->carry, m->in_len);
+            memcpy(s->out, m->carry + m->in_len, m->out_len);
+            s->in_len  = m->in_len;
+            s->out_len = m->out_len;
+        }
+        if (!s->playing) {
+            s->welcome_at = stats_clock();
+        } else if (session_unpack(&s->s, &m->pack, w_ix) < 0) {
+            perror("session_unpack");
+            s->closing = 1;
+        }
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = s };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, s->fd, &ev) < 0) {
+        perror("epoll_ctl");
+        sess_close(w, s);
+        return;
+    }
+    s->events = EPOLLIN;
+    if (flush(s) < 0 || (s->closing && s->out_len == 0)) {
+        sess_close(w, s);
+        return;
+    }
+    set_interest(w, s);
+}
+
+// Hand s to worker to. The connection goes as is: anything the client
+// sent meanwhile waits in the socket for the new owner.
+static void migrate(struct worker *w, struct wsess *s, int to) {
+    struct mail *m = calloc(1, sizeof(*m));
+    if (!m) return;
+    m->kind       = MAIL_SESSION;
+    m->fd         = s->fd;
+    m->id         = s->id;
+    m->playing    = 1;
+    m->v2         = s->v2;
+    m->features   = s->features;
+    m->tab        = s->tab;
+    m->start_ns   = s->start_ns;
+    m->bytes_sent = s->bytes_sent;
+    m->cap        = s->cap;
+    memcpy(m->player, s->player, sizeof(m->player));
+    session_pack(&s->s, &m->pack);
+
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    session_end(&s->s);
+    sess_release(w, s);
+    __atomic_add_fetch(&workers[to].assigned, 1, __ATOMIC_RELAXED);
+    mail_push(&workers[to], m);
+}
+
+// Move up to WORKER_SHED_MAX idle-between-frames games, fastest first,
+// skipping any faster than what is left to move (that would only move
+// the hot spot). At least one game stays.
+static void shed(struct worker *w, int to, uint64_t rate) {
+    uint64_t now = now_ns();
+    for (int k = 0; k < WORKER_SHED_MAX && rate > 0 && w->n_live > 1; k++) {
+        struct wsess *best = NULL;
+        uint64_t best_rate = 0;
+        for (int i = 0; i < WORKER_MAX_SESSIONS; i++) {
+            struct wsess *s = &w->pool[i];
+            if (s->fd < 0 || !s->playing || s->closing || s->in_len || s->out_len) continue;
+            uint64_t r = s->guesses_here * 1000000000ull / (now - s->here_since + 1);
+            if (r > best_rate && r <= rate + rate / 2) {
+                best      = s;
+                best_rate = r;
+            }
+        }
+        if (!best) break;
+        migrate(w, best, to);
+        rate = best_rate >= rate ? 0 : rate - best_rate;
+    }
+}
+
+// Hot upgrade: pass s to the new server with whatever it has buffered,
+// so a half-read frame or an unsent reply carries on over there.
+static void export_session(struct worker *w, struct wsess *s) {
+    unsigned char buf[UP_MSG_MAX];
+    struct handoff h;
+    memset(&h, 0, sizeof(h));
+    h.type       = UP_SESSION;
+    h.playing    = (uint8_t)s->playing;
+    h.finished   = (uint8_t)s->finished;
+    h.closing    = (uint8_t)s->closing;
+    h.v2         = s->v2;
+    h.features   = s->features;
+    h.in_len     = (uint16_t)s->in_len;
+    h.out_len    = (uint16_t)s->out_len;
+    h.id         = s->id;
+    h.tab        = s->tab;
+    h.start_ns   = s->start_ns;
+    h.bytes_sent = s->bytes_sent;
+    memcpy(h.player, s->player, sizeof(h.player));
+    if (s->playing) session_pack(&s->s, &h.pack);
+
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), s->in, s->in_len);
+    memcpy(buf + sizeof(h) + s->in_len, s->out, s->out_len);
+    if (up_send(w->export_fd, buf, sizeof(h) + s->in_len + s->out_len, &s->fd, 1) < 0) {
+        perror("upgrade: send game");
+        sess_close(w, s);
+        return;
+    }
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    if (s->playing) session_end(&s->s);
+    cap_buf_free(&s->cap);
+    close(s->fd);
+    sess_release(w, s);
+    __atomic_sub_fetch(&live, 1, __ATOMIC_RELAXED);
+}
+
+static void take_mail(struct worker *w) {
+    uint64_t n;
+    if (read(w->evfd, &n, sizeof(n)) < 0) {
+        // EAGAIN: a push raced our previous read; the list is what counts.
+    }
+    struct mail *m = mail_take(w);
+    while (m) {
+        struct mail *next = m->next;
+        if (m->kind == MAIL_SHED) {
+            shed(w, m->to, m->rate);
+            __atomic_store_n(&w->shed_pending, 0, __ATOMIC_RELAXED);
+        } else if (m->kind == MAIL_EXPORT) {
+            w->export_fd = m->fd;
+        } else {
+            adopt(w, m);
+        }
+        free(m->carry);
+        free(m);
+        m = next;
+    }
+    // Exporting: everything here goes, including games that just arrived.
+    if (w->export_fd >= 0) {
+        for (int i = 0; i < WORKER_MAX_SESSIONS; i++) {
+            if (w->pool[i].fd >= 0) export_session(w, &w->pool[i]);
+        }
+    }
+}
+
+// ---------- threads ----------
+
+static void *worker_main(void *arg) {
+    struct worker *w = arg;
+    stats_use_slot(w->slot);
+    if (fr_thread_init() < 0) perror("fr_thread_init");
+    static _Thread_local struct epoll_event ev[WORKER_EVENTS];
+
+    for (;;) {
+        int n = epoll_wait(w->epfd, ev, WORKER_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("worker: epoll_wait");
+            return NULL;
+        }
+        uint64_t t0 = now_ns(), woke = stats_clock();
+        int ready = 0, mail = 0;
+        for (int i = 0; i < n; i++) {
+            if (ev[i].data.ptr == NULL) {
+                mail = 1;
+            } else {
+                ready++;
+                serve(w, ev[i].data.ptr, woke);
+            }
+        }
+        // After the batch, so no event above refers to a session moved away.
+        if (mail) take_mail(w);
+        bump(&w->wakeups, 1);
+        bump(&w->ready, (uint64_t)ready);
+        bump(&w->busy_ns, now_ns() - t0);
+    }
+}
+
+struct sample {
+    uint64_t busy_ns, wakeups, ready, guesses;
+    uint64_t lat[LAT_BUCKETS];
+};
+
+static int p99_bucket(const uint64_t *now, const uint64_t *then) {
+    uint64_t total = 0, seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) total += now[b] - then[b];
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += now[b] - then[b];
+        if (total && seen * 100 >= total * 99) return b;
+    }
+    return 0;
+}
+
+static void *balancer_main(void *arg) {
+    (void)arg;
+    static struct sample prev[WORKER_MAX], cur[WORKER_MAX];
+    uint64_t last = now_ns();
+
+    for (;;) {
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = WORKER_BALANCE_MS * 1000000L };
+        nanosleep(&ts, NULL);
+        uint64_t now = now_ns(), span = now - last;
+        last = now;
+
+        int hot = 0, cold = 0;
+        uint64_t busy[WORKER_MAX], depth[WORKER_MAX], guesses[WORKER_MAX];
+        int p99[WORKER_MAX];
+        for (int i = 0; i < n_workers; i++) {
+            struct worker *w = &workers[i];
+            cur[i].busy_ns = __atomic_load_n(&w->busy_ns, __ATOMIC_RELAXED);
+            cur[i].wakeups = __atomic_load_n(&w->wakeups, __ATOMIC_RELAXED);
+            cur[i].ready   = __atomic_load_n(&w->ready, __ATOMIC_RELAXED);
+            cur[i].guesses = __atomic_load_n(&w->guesses, __ATOMIC_RELAXED);
+            for (int b = 0; b < LAT_BUCKETS; b++) {
+                cur[i].lat[b] = __atomic_load_n(&w->lat[b], __ATOMIC_RELAXED);
+            }
+            uint64_t wakeups = cur[i].wakeups - prev[i].wakeups;
+            busy[i]    = (cur[i].busy_ns - prev[i].busy_ns) * 100 / span;
+            depth[i]   = wakeups ? (cur[i].ready - prev[i].ready) / wakeups : 0;
+            guesses[i] = cur[i].guesses - prev[i].guesses;
+            p99[i]     = p99_bucket(cur[i].lat, prev[i].lat);
+            if (busy[i] > busy[hot]) hot = i;
+            if (busy[i] < busy[cold]) cold = i;
+            prev[i] = cur[i];
+        }
+        if (hot == cold || guesses[hot] <= guesses[cold]) continue;
+        if (__atomic_load_n(&workers[hot].shed_pending, __ATOMIC_RELAXED)) continue;
+        if (__atomic_load_n(&workers[hot].assigned, __ATOMIC_RELAXED) < 2) continue;
+
+        int overworked = busy[hot] >= WORKER_HOT_PCT && busy[hot] - busy[cold] >= WORKER_GAP_PCT;
+        int queueing   = depth[hot] >= WORKER_HOT_DEPTH && p99[hot] > p99[cold];
+        if (!overworked && !queueing) continue;
+
+        struct mail *m = calloc(1, sizeof(*m));
+        if (!m) continue;
+        m->kind = MAIL_SHED;
+        m->to   = cold;
+        m->rate = (guesses[hot] - guesses[cold]) / 2 * 1000000000ull / span;
+        __atomic_store_n(&workers[hot].shed_pending, 1, __ATOMIC_RELAXED);
+        mail_push(&workers[hot], m);
+        log_event(LOG_REBALANCE, hot, cold);
+    }
+    return NULL;
+}
+
+int workers_start(int n, int first_slot, int hub_fd, const struct word_index *ix,
+                  int evil, int replay)
+{
+    if (n < 1 || n > WORKER_MAX) return -1;
+    n_workers = n;
+    w_hub_fd  = hub_fd;
+    w_ix      = ix;
+    w_evil    = evil;
+    w_replay  = replay;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 0; i < n; i++) {
+        struct worker *w = &workers[i];
+        w->index     = i;
+        w->slot      = first_slot + i;
+        w->export_fd = -1;
+        w->seed      = (unsigned int)(time(NULL) ^ (getpid() << 16) ^ (i << 8));
+        w->pool      = calloc(WORKER_MAX_SESSIONS, sizeof(*w->pool));
+        w->free_idx  = malloc(WORKER_MAX_SESSIONS * sizeof(*w->free_idx));
+        w->epfd      = epoll_create1(EPOLL_CLOEXEC);
+        w->evfd      = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (!w->pool || !w->free_idx || w->epfd < 0 || w->evfd < 0) return -1;
+        for (int k = WORKER_MAX_SESSIONS - 1; k >= 0; k--) {
+            w->pool[k].fd = -1;
+            w->free_idx[w->n_free++] = k;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->evfd, &ev) < 0) return -1;
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_main, w) != 0) return -1;
+        if (ncpu > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET((int)(i % ncpu), &set);
+            (void)pthread_setaffinity_np(tid, sizeof(set), &set);
+        }
+        pthread_detach(tid);
+    }
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, balancer_main, NULL) != 0) return -1;
+    pthread_detach(tid);
+    return 0;
+}
+
+// The worker with the fewest sessions; ties rotate. Accept loop only.
+static struct worker *place(void) {
+    int best = -1, best_n = 0;
+    for (int k = 0; k < n_workers; k++) {
+        int i = (int)((place_rr + (unsigned int)k) % (unsigned int)n_workers);
+        int a = __atomic_load_n(&workers[i].assigned, __ATOMIC_RELAXED);
+        if (best < 0 || a < best_n) {
+            best   = i;
+            best_n = a;
+        }
+    }
+    place_rr++;
+    return &workers[best];
+}
+
+static void post(struct worker *w, struct mail *m) {
+    __atomic_add_fetch(&live, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&w->assigned, 1, __ATOMIC_RELAXED);
+    mail_push(w, m);
+}
+
+int32_t workers_submit(int fd) {
+    if (__atomic_load_n(&live, __ATOMIC_RELAXED) >= WORKER_MAX_SESSIONS) return -1;
+    struct mail *m = calloc(1, sizeof(*m));
+    if (!m) return -1;
+
+    int32_t id = ++next_id;
+    m->kind = MAIL_CONN;
+    m->fd   = fd;
+    m->id   = id;
+    post(place(), m);
+    return id;
+}
+
+int workers_export(int up_fd) {
+    struct mail *m[WORKER_MAX];
+    for (int i = 0; i < n_workers; i++) {
+        m[i] = calloc(1, sizeof(*m[i]));
+        if (!m[i]) {
+            while (i-- > 0) free(m[i]);
+            return -1;
+        }
+        m[i]->kind = MAIL_EXPORT;
+        m[i]->fd   = up_fd;
+    }
+    for (int i = 0; i < n_workers; i++) mail_push(&workers[i], m[i]);
+    return 0;
+}
+
+int workers_resume(const void *msg, size_t len, int fd) {
+    struct handoff h;
+    if (len < sizeof(h)) return -1;
+    memcpy(&h, msg, sizeof(h));
+    if (h.type != UP_SESSION || h.in_len > WS_IN_MAX || h.out_len > WS_OUT_MAX ||
+        len != sizeof(h) + h.in_len + h.out_len) {
+        return -1;
+    }
+    struct mail *m = calloc(1, sizeof(*m));
+    unsigned char *carry = malloc(len - sizeof(h) + 1);
+    if (!m || !carry) {
+        free(m);
+        free(carry);
+        return -1;
+    }
+    memcpy(carry, (const unsigned char *)msg + sizeof(h), len - sizeof(h));
+
+    m->kind       = MAIL_RESUME;
+    m->fd         = fd;
+    m->id         = h.id;
+    m->pack       = h.pack;
+    m->playing    = h.playing;
+    m->finished   = h.finished;
+    m->closing    = h.closing;
+    m->v2         = h.v2;
+    m->features   = h.features;
+    m->tab        = sesstab_enabled() && h.tab >= 0 && (uint32_t)h.tab < SESSTAB_SLOTS ? h.tab : -1;
+    m->start_ns   = h.start_ns;
+    m->bytes_sent = h.bytes_sent;
+    m->in_len     = h.in_len;
+    m->out_len    = h.out_len;
+    m->carry      = carry;
+    memcpy(m->player, h.player, sizeof(m->player));
+    m->player[LB_NAME_MAX] = '\0';
+    if (h.id > next_id) next_id = h.id;
+    if (m->tab >= 0) sesstab_rehome(m->tab);
+    post(place(), m);
+    return 0;
+}
+
+int workers_active(void) {
+    return __atomic_load_n(&live, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,65 @@
+#ifndef HANGMAN_WORKER_H
+#define HANGMAN_WORKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hangman_index.h"
+
+// Worker threads (--workers N): instead of a child process per client,
+// the accept loop hands each connection to one of N threads, each an
+// epoll loop over many sessions and pinned to its own CPU.
+//
+// Every worker has a mailbox: a lock-free list that any thread pushes to
+// with a compare-and-swap and that only the owner empties, all at once,
+// with one exchange. New connections arrive that way, and so do sessions
+// moved from another worker: the session travels as its fd plus a
+// session_pack (word index, guessed mask, misses), and the receiving
+// worker rebuilds it in its own memory.
+//
+// A balancer thread samples every worker each WORKER_BALANCE_MS: the
+// share of the interval it spent working, how many connections were
+// ready per wakeup (queue depth), guesses served and the p99 turnaround
+// from wakeup to reply. When the busiest worker is hot and well ahead of
+// the idlest, it asks the busy one to shed about half the difference in
+// guesses. That worker moves its fastest-guessing sessions that fit, so a
+// few heavy connections landing on one core get spread out instead of
+// queueing behind each other.
+//
+// Workers play solo games (v1 or v2, hints, P<name>, W<idx> on --replay
+// servers and K[<token>] on --resume ones); other start commands go to
+// the hub as they do from a child. A worker session is captured,
+// flight-recorded (one ring per worker thread), watchable with SS<id>
+// and traced like a child's game, under its session id.
+
+#define WORKER_MAX          8
+#define WORKER_MAX_SESSIONS 1024    // across all workers
+#define WORKER_BALANCE_MS   50
+#define WORKER_HOT_PCT      50      // busy share that makes a worker hot
+#define WORKER_GAP_PCT      20      // ... if the idlest is this much less busy
+#define WORKER_HOT_DEPTH    4       // or: ready connections per wakeup
+#define WORKER_SHED_MAX     8       // sessions moved per request
+
+// Start n workers and the balancer; worker i counts into stats slot
+// first_slot + i. 0 on success, -1 on error.
+int workers_start(int n, int first_slot, int hub_fd, const struct word_index *ix,
+                  int evil, int replay);
+
+// Accept loop: hand over a fresh connection (nothing sent yet). Returns
+// the session id, or -1 if the workers are full.
+int32_t workers_submit(int fd);
+
+// Sessions held by workers, including any still in a mailbox.
+int workers_active(void);
+
+// Hot upgrade, old server: every worker sends its games down up_fd
+// (UP_SESSION, fd attached) and drops them; so does any game that reaches
+// a worker later. Stop submitting first. 0 on success, -1 on error.
+int workers_export(int up_fd);
+
+// Hot upgrade, new server: queue one UP_SESSION message, with the fd that
+// came with it, on a worker. Accept loop only. 0 on success, -1 if the
+// message is malformed or memory is short (fd is the caller's then).
+int workers_resume(const void *msg, size_t len, int fd);
+
+#endif